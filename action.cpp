@@ -16,6 +16,16 @@
 
 #include "todraw.h"
 
+void Action::zValues(QVector<qreal> &/*values*/) const
+{
+}
+
+void Action::remapZValues(const QHash<qreal, qreal> &/*newValues*/)
+{
+}
+
+
+
 ActionAdd::ActionAdd(ToDraw *item, QGraphicsScene *scene)
  : m_item(item), m_scene(scene), m_done(false), m_shouldAdd(false)
 {
@@ -28,6 +38,24 @@ ActionAdd::~ActionAdd()
 	if (!m_done) delete m_item;
 }
 
+ToDraw *ActionAdd::item() const
+{
+	return m_item;
+}
+
+int ActionAdd::memoryUsage() const
+{
+	return sizeof(ActionAdd) + (m_done ? 0 : sizeof(ToDraw));
+}
+
+Action *ActionAdd::clone(ToDraw *item, QGraphicsScene *scene) const
+{
+	ActionAdd *action = new ActionAdd(item, scene);
+	action->m_done = m_done;
+	action->m_shouldAdd = m_shouldAdd;
+	return action;
+}
+
 void ActionAdd::redo()
 {
 	if (m_shouldAdd) {
@@ -56,6 +84,24 @@ ActionRemove::~ActionRemove()
 	if (m_done) delete m_item;
 }
 
+ToDraw *ActionRemove::item() const
+{
+	return m_item;
+}
+
+int ActionRemove::memoryUsage() const
+{
+	return sizeof(ActionRemove) + (m_done ? sizeof(ToDraw) : 0);
+}
+
+Action *ActionRemove::clone(ToDraw *item, QGraphicsScene *scene) const
+{
+	ActionRemove *action = new ActionRemove(item, QPointF(), scene);
+	action->m_oldPos = m_oldPos;
+	action->m_done = m_done;
+	return action;
+}
+
 void ActionRemove::redo()
 {
 	m_scene->removeItem(m_item);
@@ -71,13 +117,41 @@ void ActionRemove::undo()
 
 
 
-ActionMove::ActionMove(ToDraw *item, const QPointF &oldPos, int zValue, QGraphicsScene *scene)
+ActionMove::ActionMove(ToDraw *item, const QPointF &oldPos, qreal zValue, QGraphicsScene *scene)
  : m_item(item), m_zValue(zValue), m_scene(scene)
 {
 	m_oldPos = QPointF(oldPos.x() / scene->width(), oldPos.y() / scene->height());
 	m_newPos = QPointF(m_item->pos().x() / scene->width(), m_item->pos().y() / scene->height());
 }
 
+ToDraw *ActionMove::item() const
+{
+	return m_item;
+}
+
+int ActionMove::memoryUsage() const
+{
+	return sizeof(ActionMove);
+}
+
+Action *ActionMove::clone(ToDraw *item, QGraphicsScene *scene) const
+{
+	ActionMove *action = new ActionMove(item, QPointF(), m_zValue, scene);
+	action->m_oldPos = m_oldPos;
+	action->m_newPos = m_newPos;
+	return action;
+}
+
+void ActionMove::zValues(QVector<qreal> &values) const
+{
+	values << m_zValue;
+}
+
+void ActionMove::remapZValues(const QHash<qreal, qreal> &newValues)
+{
+	m_zValue = newValues.value(m_zValue, m_zValue);
+}
+
 void ActionMove::redo()
 {
 	qreal zValue = m_item->zValue();
@@ -13,18 +13,44 @@
 #ifndef _ACTION_H_
 #define _ACTION_H_
 
+#include <QHash>
 #include <QUndoCommand>
 #include <QPointF>
+#include <QVector>
 
 class ToDraw;
 
 class QGraphicsScene;
 
-class ActionAdd : public QUndoCommand
+class Action : public QUndoCommand
+{
+	public:
+		// The item acted upon, be it in the scene right now or not
+		virtual ToDraw *item() const = 0;
+
+		// Z values remembered by the action itself, used to
+		// renormalize them together with the ones of the items
+		virtual void zValues(QVector<qreal> &values) const;
+		virtual void remapZValues(const QHash<qreal, qreal> &newValues);
+
+		// Rough estimate of the bytes kept alive by the action,
+		// counting the item when the action owns it
+		virtual int memoryUsage() const = 0;
+
+		// The same action, done or not, on a copy of its item in
+		// another scene, see TimeLapse
+		virtual Action *clone(ToDraw *item, QGraphicsScene *scene) const = 0;
+};
+
+class ActionAdd : public Action
 {
 	public:
 		ActionAdd(ToDraw *item, QGraphicsScene *scene);
 		~ActionAdd();
+
+		ToDraw *item() const override;
+		int memoryUsage() const override;
+		Action *clone(ToDraw *item, QGraphicsScene *scene) const override;
 		
 		void redo() override;
 		void undo() override;
@@ -37,11 +63,15 @@ class ActionAdd : public QUndoCommand
 };
 
 
-class ActionRemove : public QUndoCommand
+class ActionRemove : public Action
 {
 	public:
 		ActionRemove(ToDraw *item, const QPointF &oldPos, QGraphicsScene *scene);
 		~ActionRemove();
+
+		ToDraw *item() const override;
+		int memoryUsage() const override;
+		Action *clone(ToDraw *item, QGraphicsScene *scene) const override;
 		
 		void redo() override;
 		void undo() override;
@@ -53,10 +83,16 @@ class ActionRemove : public QUndoCommand
 		bool m_done;
 };
 
-class ActionMove : public QUndoCommand
+class ActionMove : public Action
 {
 	public:
-		ActionMove(ToDraw *item, const QPointF &oldPos, int zValue, QGraphicsScene *scene);
+		ActionMove(ToDraw *item, const QPointF &oldPos, qreal zValue, QGraphicsScene *scene);
+
+		ToDraw *item() const override;
+		void zValues(QVector<qreal> &values) const override;
+		void remapZValues(const QHash<qreal, qreal> &newValues) override;
+		int memoryUsage() const override;
+		Action *clone(ToDraw *item, QGraphicsScene *scene) const override;
 		
 		void redo() override;
 		void undo() override;
@@ -0,0 +1,191 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Opening and saving documents on slow and failing file:// paths */
+
+#include <QFile>
+#include <QPointer>
+#include <QTemporaryDir>
+#include <QTest>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "filetransfer.h"
+
+// What a transfer ended with, it is gone by the time the test looks
+struct Outcome
+{
+  int count = 0;
+  bool ok = false;
+  QByteArray data;
+};
+
+static void watch(FileTransfer *transfer, Outcome *outcome)
+{
+  QObject::connect(transfer, &FileTransfer::finished, [transfer, outcome](bool ok)
+  {
+    outcome->count++;
+    outcome->ok = ok;
+    outcome->data = transfer->data();
+  });
+}
+
+class FileTransferTest : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+
+  void read();
+  void readMissing();
+  void write();
+  void writeToMissingDirectory();
+  void writesEndInOrder();
+  void slowRead();
+  void killedRead();
+
+private:
+  QString path(const QString &name) const;
+  bool makeFifo(const QString &fileName) const;
+
+  QTemporaryDir m_dir;
+};
+
+void FileTransferTest::initTestCase()
+{
+  QVERIFY(m_dir.isValid());
+}
+
+QString FileTransferTest::path(const QString &name) const
+{
+  return m_dir.path() + QLatin1Char('/') + name;
+}
+
+// Reading a fifo blocks until somebody writes to it, a disk as slow as the test wants
+bool FileTransferTest::makeFifo(const QString &fileName) const
+{
+#ifdef Q_OS_UNIX
+  return mkfifo(QFile::encodeName(fileName).constData(), 0600) == 0;
+#else
+  Q_UNUSED(fileName);
+  return false;
+#endif
+}
+
+void FileTransferTest::read()
+{
+  QFile file(path(QStringLiteral("read.tuberling")));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write("a tuberling");
+  file.close();
+
+  Outcome outcome;
+  watch(FileTransfer::get(QUrl::fromLocalFile(file.fileName())), &outcome);
+  QTRY_COMPARE(outcome.count, 1);
+  QVERIFY(outcome.ok);
+  QCOMPARE(outcome.data, QByteArray("a tuberling"));
+}
+
+void FileTransferTest::readMissing()
+{
+  Outcome outcome;
+  watch(FileTransfer::get(QUrl::fromLocalFile(path(QStringLiteral("missing.tuberling")))), &outcome);
+  QTRY_COMPARE(outcome.count, 1);
+  QVERIFY(!outcome.ok);
+}
+
+void FileTransferTest::write()
+{
+  const QString fileName = path(QStringLiteral("write.tuberling"));
+  Outcome outcome;
+  watch(FileTransfer::put(QByteArray("a tuberling"), QUrl::fromLocalFile(fileName)), &outcome);
+  QTRY_COMPARE(outcome.count, 1);
+  QVERIFY(outcome.ok);
+
+  QFile file(fileName);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QCOMPARE(file.readAll(), QByteArray("a tuberling"));
+}
+
+void FileTransferTest::writeToMissingDirectory()
+{
+  Outcome outcome;
+  watch(FileTransfer::put(QByteArray("a tuberling"), QUrl::fromLocalFile(path(QStringLiteral("missing/write.tuberling")))), &outcome);
+  QTRY_COMPARE(outcome.count, 1);
+  QVERIFY(!outcome.ok);
+}
+
+// Saving twice in a row leaves the second save, whichever write is faster
+void FileTransferTest::writesEndInOrder()
+{
+  const QString fileName = path(QStringLiteral("twice.tuberling"));
+  const QUrl url = QUrl::fromLocalFile(fileName);
+  Outcome first, second;
+  watch(FileTransfer::put(QByteArray(1 << 24, 'a'), url), &first);
+  watch(FileTransfer::put(QByteArray("b"), url), &second);
+  QTRY_COMPARE(first.count + second.count, 2);
+  QVERIFY(first.ok && second.ok);
+
+  QFile file(fileName);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QCOMPARE(file.readAll(), QByteArray("b"));
+}
+
+void FileTransferTest::slowRead()
+{
+  const QString fileName = path(QStringLiteral("slow.tuberling"));
+  if (!makeFifo(fileName))
+    QSKIP("No fifos here");
+
+  // reading it right here would never come back
+  Outcome outcome;
+  watch(FileTransfer::get(QUrl::fromLocalFile(fileName)), &outcome);
+
+  // the event loop goes on meanwhile
+  QTest::qWait(100);
+  QCOMPARE(outcome.count, 0);
+
+  // the reader has it open, this does not block
+  QFile writer(fileName);
+  QVERIFY(writer.open(QIODevice::WriteOnly));
+  writer.write("a slow tuberling");
+  writer.close();
+
+  QTRY_COMPARE(outcome.count, 1);
+  QVERIFY(outcome.ok);
+  QCOMPARE(outcome.data, QByteArray("a slow tuberling"));
+}
+
+void FileTransferTest::killedRead()
+{
+  const QString fileName = path(QStringLiteral("killed.tuberling"));
+  if (!makeFifo(fileName))
+    QSKIP("No fifos here");
+
+  Outcome outcome;
+  QPointer<FileTransfer> transfer = FileTransfer::get(QUrl::fromLocalFile(fileName));
+  watch(transfer, &outcome);
+  transfer->kill();
+  QTRY_VERIFY(!transfer);
+
+  // let the read end, the thread pool waits for it otherwise
+  QFile writer(fileName);
+  QVERIFY(writer.open(QIODevice::WriteOnly));
+  writer.close();
+  QTest::qWait(100);
+  QCOMPARE(outcome.count, 0);
+}
+
+QTEST_GUILESS_MAIN(FileTransferTest)
+
+#include "filetransfertest.moc"
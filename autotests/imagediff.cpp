@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Per pixel comparison of rendered images */
+
+#include "imagediff.h"
+
+#include <QtAlgorithms>
+#include <QVector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  struct Totals
+  {
+    int maxDifference;
+    qint64 pixelsOverTolerance;
+    qint64 sum;
+  };
+
+  QVector<QRgb> heatPalette(int tolerance)
+  {
+    QVector<QRgb> palette(256);
+    palette[0] = qRgb(0, 0, 0);
+    for (int difference = 1; difference < 256; ++difference)
+    {
+      if (difference > tolerance)
+        palette[difference] = qRgb(255, 255, 255);
+      else
+        palette[difference] = qRgb(64 + difference * 191 / qMax(tolerance, 1), 0, 0);
+    }
+    return palette;
+  }
+
+  inline int pixelDifference(QRgb a, QRgb b)
+  {
+    return qMax(qMax(qAbs(qRed(a) - qRed(b)), qAbs(qGreen(a) - qGreen(b))),
+                qMax(qAbs(qBlue(a) - qBlue(b)), qAbs(qAlpha(a) - qAlpha(b))));
+  }
+
+  // from x to the end of the row
+  void diffScalar(const QRgb *a, const QRgb *b, QRgb *heat, int x, int count, const QRgb *palette, int tolerance, Totals *totals)
+  {
+    for (; x < count; ++x)
+    {
+      const int difference = pixelDifference(a[x], b[x]);
+      totals->maxDifference = qMax(totals->maxDifference, difference);
+      totals->sum += difference;
+      if (difference > tolerance) totals->pixelsOverTolerance++;
+      heat[x] = palette[difference];
+    }
+  }
+
+#ifdef __SSE2__
+  // Four pixels at a time, returns where the scalar code has to go on from
+  int diffSse2(const QRgb *a, const QRgb *b, QRgb *heat, int count, const QRgb *palette, int tolerance, Totals *totals)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    const __m128i limit = _mm_set1_epi32(tolerance);
+    __m128i maxima = zero;
+    __m128i sums = zero;
+    qint64 over = 0;
+    alignas(16) quint32 differences[4];
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+      const __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+      const __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+      // absolute difference of every channel, then the largest of each pixel in its low byte
+      __m128i d = _mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa));
+      d = _mm_max_epu8(d, _mm_srli_epi32(d, 16));
+      d = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+      d = _mm_and_si128(d, lowByte);
+
+      maxima = _mm_max_epi16(maxima, d);
+      sums = _mm_add_epi64(sums, _mm_sad_epu8(d, zero));
+      over += qPopulationCount(uint(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(d, limit)))));
+
+      _mm_store_si128(reinterpret_cast<__m128i *>(differences), d);
+      heat[x] = palette[differences[0]];
+      heat[x + 1] = palette[differences[1]];
+      heat[x + 2] = palette[differences[2]];
+      heat[x + 3] = palette[differences[3]];
+    }
+
+    _mm_store_si128(reinterpret_cast<__m128i *>(differences), maxima);
+    for (int i = 0; i < 4; ++i)
+      totals->maxDifference = qMax(totals->maxDifference, int(differences[i]));
+    alignas(16) qint64 halves[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(halves), sums);
+    totals->sum += halves[0] + halves[1];
+    totals->pixelsOverTolerance += over;
+    return x;
+  }
+#endif
+
+  ImageDiff diff(const QImage &a, const QImage &b, int tolerance, bool simd)
+  {
+    ImageDiff result;
+    if (a.size() != b.size())
+    {
+      // nothing lines up, every pixel counts as different
+      result.maxDifference = 255;
+      result.pixelsOverTolerance = qMax(qint64(a.width()) * a.height(), qint64(b.width()) * b.height());
+      result.meanDifference = 255;
+      return result;
+    }
+
+    const QImage first = a.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage second = b.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QVector<QRgb> palette = heatPalette(tolerance);
+    result.heatmap = QImage(first.size(), QImage::Format_RGB32);
+    Totals totals = { 0, 0, 0 };
+    for (int y = 0; y < first.height(); ++y)
+    {
+      const QRgb *rowA = reinterpret_cast<const QRgb *>(first.constScanLine(y));
+      const QRgb *rowB = reinterpret_cast<const QRgb *>(second.constScanLine(y));
+      QRgb *heat = reinterpret_cast<QRgb *>(result.heatmap.scanLine(y));
+      int x = 0;
+#ifdef __SSE2__
+      if (simd)
+        x = diffSse2(rowA, rowB, heat, first.width(), palette.constData(), tolerance, &totals);
+#else
+      Q_UNUSED(simd);
+#endif
+      diffScalar(rowA, rowB, heat, x, first.width(), palette.constData(), tolerance, &totals);
+    }
+
+    const qint64 pixels = qint64(first.width()) * first.height();
+    result.maxDifference = totals.maxDifference;
+    result.pixelsOverTolerance = totals.pixelsOverTolerance;
+    result.meanDifference = pixels ? double(totals.sum) / pixels : 0.0;
+    return result;
+  }
+}
+
+ImageDiff diffImages(const QImage &a, const QImage &b, int tolerance)
+{
+  return diff(a, b, tolerance, true);
+}
+
+ImageDiff diffImagesScalar(const QImage &a, const QImage &b, int tolerance)
+{
+  return diff(a, b, tolerance, false);
+}
+
+QImage edgeMask(const QImage &image, int tolerance)
+{
+  const QImage source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  const int width = source.width();
+  const int height = source.height();
+  QImage edges(source.size(), QImage::Format_Grayscale8);
+  edges.fill(0);
+  for (int y = 0; y < height; ++y)
+  {
+    const QRgb *row = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+    const QRgb *below = y + 1 < height ? reinterpret_cast<const QRgb *>(source.constScanLine(y + 1)) : nullptr;
+    for (int x = 0; x < width; ++x)
+    {
+      const bool right = x + 1 < width && pixelDifference(row[x], row[x + 1]) > tolerance;
+      const bool down = below && pixelDifference(row[x], below[x]) > tolerance;
+      if (!right && !down) continue;
+
+      // both sides of the step, and one more pixel around them
+      for (int dy = -1; dy <= (down ? 2 : 1); ++dy)
+      {
+        if (y + dy < 0 || y + dy >= height) continue;
+        uchar *mask = edges.scanLine(y + dy);
+        for (int dx = -1; dx <= (right ? 2 : 1); ++dx)
+        {
+          if (x + dx >= 0 && x + dx < width) mask[x + dx] = 255;
+        }
+      }
+    }
+  }
+  return edges;
+}
+
+qint64 pixelsOverTolerance(const ImageDiff &diff, const QImage &edges, const QRect &region)
+{
+  const QRect rect = region.intersected(diff.heatmap.rect()).intersected(edges.rect());
+  qint64 count = 0;
+  for (int y = rect.top(); y <= rect.bottom(); ++y)
+  {
+    const QRgb *heat = reinterpret_cast<const QRgb *>(diff.heatmap.constScanLine(y));
+    const uchar *mask = edges.constScanLine(y);
+    for (int x = rect.left(); x <= rect.right(); ++x)
+    {
+      // white is past the tolerance, see heatPalette()
+      if (!mask[x] && heat[x] == qRgb(255, 255, 255)) count++;
+    }
+  }
+  return count;
+}
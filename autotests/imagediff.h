@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Per pixel comparison of rendered images */
+
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+#include <QImage>
+
+// The difference of a pixel is the largest one of its four channels
+struct ImageDiff
+{
+  int maxDifference;
+  qint64 pixelsOverTolerance;
+  double meanDifference;
+  QImage heatmap;		// black where equal, from dark to bright red up to the tolerance, white past it
+};
+
+// Both images get converted to premultiplied ARGB32. Images of different
+// sizes differ everywhere. Uses SSE2 where the compiler targets it.
+ImageDiff diffImages(const QImage &a, const QImage &b, int tolerance);
+
+// The same without SIMD, to check the fast path against
+ImageDiff diffImagesScalar(const QImage &a, const QImage &b, int tolerance);
+
+// The antialiased edges of the shapes of image: the pixels differing from
+// a neighbour by more than tolerance, and their neighbours, since drawing
+// at a fractional position moves edges by up to a pixel. Format_Grayscale8,
+// 255 on the edges.
+QImage edgeMask(const QImage &image, int tolerance);
+
+// The pixels of region past the tolerance of diff, but those on the edges
+qint64 pixelsOverTolerance(const ImageDiff &diff, const QImage &edges, const QRect &region);
+
+#endif
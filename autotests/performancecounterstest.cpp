@@ -0,0 +1,159 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The performance counters as seen over D-Bus */
+
+#include <QApplication>
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusReply>
+#include <QTest>
+
+#include "filefactory.h"
+#include "headlesscallbacks.h"
+#include "performancecounters.h"
+#include "playground.h"
+
+// Maps nested in a variant come back as D-Bus arguments
+static QVariantMap toMap(const QVariant &value)
+{
+  if (value.canConvert<QDBusArgument>())
+    return qdbus_cast<QVariantMap>(value.value<QDBusArgument>());
+  return value.toMap();
+}
+
+class PerformanceCountersTest : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void startupPhases();
+  void caches();
+  void scene();
+  void frameTimes();
+  void soundStartLatency();
+  void counters();
+
+private:
+  QDBusInterface *m_interface = nullptr;
+  HeadlessCallbacks m_callbacks;
+  PlayGround *m_playGround = nullptr;
+};
+
+void PerformanceCountersTest::initTestCase()
+{
+  QDBusConnection bus = QDBusConnection::sessionBus();
+  if (!bus.isConnected())
+    QSKIP("No session bus, run through dbus-run-session");
+
+  QVERIFY(bus.registerObject(QStringLiteral("/PerformanceCounters"), PerformanceCounters::self(), QDBusConnection::ExportScriptableSlots));
+  m_interface = new QDBusInterface(bus.baseService(), QStringLiteral("/PerformanceCounters"), QStringLiteral("org.kde.ktuberling.PerformanceCounters"), bus, this);
+  QVERIFY(m_interface->isValid());
+
+  m_playGround = new PlayGround(&m_callbacks);
+  PerformanceCounters::self()->setPlayGround(m_playGround);
+}
+
+void PerformanceCountersTest::cleanupTestCase()
+{
+  delete m_playGround;
+}
+
+void PerformanceCountersTest::startupPhases()
+{
+  PerformanceCounters::self()->startupPhase("test phase");
+
+  QDBusReply<QVariantMap> reply = m_interface->call(QStringLiteral("startupPhases"));
+  QVERIFY(reply.isValid());
+  QVERIFY(reply.value().contains(QStringLiteral("test phase")));
+  QVERIFY(reply.value().contains(QStringLiteral("total")));
+}
+
+void PerformanceCountersTest::caches()
+{
+  PerformanceCounters::self()->cacheMiss(PerformanceCounters::SceneCache);
+  PerformanceCounters::self()->cacheHit(PerformanceCounters::SceneCache);
+  PerformanceCounters::self()->cacheHit(PerformanceCounters::SceneCache);
+  PerformanceCounters::self()->cacheHit(PerformanceCounters::SceneCache);
+
+  QDBusReply<QVariantMap> reply = m_interface->call(QStringLiteral("caches"));
+  QVERIFY(reply.isValid());
+  const QVariantMap scenes = toMap(reply.value().value(QStringLiteral("scenes")));
+  QCOMPARE(scenes.value(QStringLiteral("hits")).toLongLong(), qint64(3));
+  QCOMPARE(scenes.value(QStringLiteral("misses")).toLongLong(), qint64(1));
+  QCOMPARE(scenes.value(QStringLiteral("hitRate")).toDouble(), 0.75);
+  QVERIFY(reply.value().contains(QStringLiteral("elementPixmaps")));
+  QVERIFY(reply.value().contains(QStringLiteral("backgroundLevels")));
+}
+
+void PerformanceCountersTest::scene()
+{
+  QVERIFY(m_playGround->loadPlayGround(FileFactory::locate(QStringLiteral("pics/default_theme.theme"))));
+  m_playGround->fillWithRandomItems(10);
+
+  QDBusReply<QVariantMap> reply = m_interface->call(QStringLiteral("scene"));
+  QVERIFY(reply.isValid());
+  QCOMPARE(reply.value().value(QStringLiteral("items")).toInt(), 10);
+  QCOMPARE(reply.value().value(QStringLiteral("undoCommands")).toInt(), 10);
+  QVERIFY(reply.value().value(QStringLiteral("undoBytes")).toLongLong() > 0);
+}
+
+void PerformanceCountersTest::frameTimes()
+{
+  // more than the history, only the last ones are kept
+  for (int frame = 1; frame <= 200; ++frame)
+    PerformanceCounters::self()->addFrameTime(frame * 1000000);
+
+  QDBusReply<QVariantList> reply = m_interface->call(QStringLiteral("frameTimes"));
+  QVERIFY(reply.isValid());
+  QCOMPARE(reply.value().count(), 120);
+  QCOMPARE(reply.value().first().toDouble(), 81.0);
+  QCOMPARE(reply.value().last().toDouble(), 200.0);
+}
+
+void PerformanceCountersTest::soundStartLatency()
+{
+  PerformanceCounters::self()->addSoundStartLatency(10);
+  PerformanceCounters::self()->addSoundStartLatency(30);
+
+  QDBusReply<QVariantMap> reply = m_interface->call(QStringLiteral("soundStartLatency"));
+  QVERIFY(reply.isValid());
+  QCOMPARE(reply.value().value(QStringLiteral("count")).toInt(), 2);
+  QCOMPARE(reply.value().value(QStringLiteral("lastMs")).toLongLong(), qint64(30));
+  QCOMPARE(reply.value().value(QStringLiteral("meanMs")).toDouble(), 20.0);
+  QCOMPARE(reply.value().value(QStringLiteral("maxMs")).toLongLong(), qint64(30));
+}
+
+void PerformanceCountersTest::counters()
+{
+  QDBusReply<QVariantMap> reply = m_interface->call(QStringLiteral("counters"));
+  QVERIFY(reply.isValid());
+  QVERIFY(reply.value().contains(QStringLiteral("startupPhases")));
+  QVERIFY(reply.value().contains(QStringLiteral("caches")));
+  QVERIFY(reply.value().contains(QStringLiteral("scene")));
+  QVERIFY(reply.value().contains(QStringLiteral("frameTimes")));
+  QVERIFY(reply.value().contains(QStringLiteral("soundStartLatency")));
+  QVERIFY(reply.value().contains(QStringLiteral("memory")));
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  // So that FileFactory finds our data
+  app.setApplicationName(QStringLiteral("ktuberling"));
+
+  PerformanceCountersTest test;
+  return QTest::qExec(&test, argc, argv);
+}
+
+#include "performancecounterstest.moc"
@@ -0,0 +1,527 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Benchmarks of the play ground hot paths */
+
+#include <QAction>
+#include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMouseEvent>
+#include <QSvgRenderer>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QXmlStreamReader>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "filefactory.h"
+#include "gameboard.h"
+#include "headlesscallbacks.h"
+#include "playground.h"
+#include "savegame.h"
+#include "soundfactory.h"
+#include "todraw.h"
+
+static const char *defaultTheme = "default_theme.theme";
+
+// Also tells which gameboards got registered
+class BenchmarkCallbacks : public HeadlessCallbacks, public SoundFactoryCallbacks
+{
+public:
+  void registerGameboard(const QString &/*menuText*/, const QString &boardFile, const QString &/*gameboardFile*/) override
+  {
+    gameboards << boardFile;
+  }
+
+  void unregisterGameboard(const QString &boardFile) override
+  {
+    gameboards.removeAll(boardFile);
+  }
+
+  bool isSoundEnabled() const override
+  {
+    return true;
+  }
+
+  void registerLanguage(const QString &/*code*/, const QString &/*soundFile*/, bool /*enabled*/) override
+  {
+  }
+
+  QStringList gameboards;
+};
+
+class PlayGroundBenchmark : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void toDrawContains_data();
+  void toDrawContains();
+  void warehousePick_data();
+  void warehousePick();
+  void loadPlayGround_data();
+  void loadPlayGround();
+  void registerPlayGrounds();
+  void saveLoadRoundTrip_data();
+  void saveLoadRoundTrip();
+  void getPicture();
+  void saveWhileHolding();
+  void dragNewItem_data();
+  void dragNewItem();
+  void playSoundLookup();
+  void memoryPerItem();
+
+private:
+  QStringList objectNames(const QString &themeFile) const;
+  QString svgFile(const QString &themeFile) const;
+  QString writeSaveFile(int items);
+  QPoint warehousePos(const QString &element) const;
+  int savedItems();
+
+  BenchmarkCallbacks m_callbacks;
+  PlayGround *m_playGround;
+  SoundFactory *m_soundFactory;
+  QTemporaryDir m_tempDir;
+};
+
+void PlayGroundBenchmark::initTestCase()
+{
+  QVERIFY(m_tempDir.isValid());
+
+  const QString theme = FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme));
+  QVERIFY2(!theme.isEmpty(), "Themes not found, is XDG_DATA_DIRS set?");
+
+  m_playGround = new PlayGround(&m_callbacks);
+  m_playGround->resize(1024, 768);
+  m_playGround->show();
+  QVERIFY(QTest::qWaitForWindowExposed(m_playGround));
+  QVERIFY(m_playGround->loadPlayGround(theme));
+
+  m_soundFactory = new SoundFactory(&m_callbacks);
+  QVERIFY(m_soundFactory->loadLanguage(FileFactory::locate(QStringLiteral("sounds/en.soundtheme"))));
+}
+
+void PlayGroundBenchmark::cleanupTestCase()
+{
+  delete m_soundFactory;
+  delete m_playGround;
+}
+
+QStringList PlayGroundBenchmark::objectNames(const QString &themeFile) const
+{
+  QStringList names;
+  QFile file(themeFile);
+  QDomDocument document;
+  if (file.open(QIODevice::ReadOnly) && document.setContent(&file))
+  {
+    const QDomNodeList objects = document.documentElement().elementsByTagName(QStringLiteral( "object" ));
+    for (int i = 0; i < objects.count(); ++i)
+      names << objects.item(i).toElement().attribute(QStringLiteral( "name" ));
+  }
+  // This is the order the warehouse is searched in, see Gameboard::objectAt()
+  names.sort();
+  return names;
+}
+
+QString PlayGroundBenchmark::svgFile(const QString &themeFile) const
+{
+  QFile file(themeFile);
+  QDomDocument document;
+  if (!file.open(QIODevice::ReadOnly) || !document.setContent(&file))
+    return QString();
+  return FileFactory::locate(QLatin1String( "pics/" ) + document.documentElement().attribute(QStringLiteral( "gameboard" )));
+}
+
+// Writes a save game of the default theme with the given number of items
+QString PlayGroundBenchmark::writeSaveFile(int items)
+{
+  const QString theme = FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme));
+  const QStringList names = objectNames(theme);
+  QSvgRenderer renderer(svgFile(theme));
+  const QRectF background = renderer.boundsOnElement(QStringLiteral( "background" ));
+
+  const QString fileName = m_tempDir.path() + QStringLiteral("/items%1.tuberling").arg(items);
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return QString();
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_5);
+  out << QStringLiteral("KTuberlingSaveGameV4");
+  out << QString::fromLatin1(defaultTheme);
+  for (int i = 0; i < items; ++i)
+  {
+    // Spread the items deterministically over the background
+    const QPointF pos(background.left() + (i * 37) % int(background.width()),
+                      background.top() + (i * 53) % int(background.height()));
+    out << pos;
+    out << names.at(i % names.count());
+    out << qreal(i + 1);
+  }
+  return fileName;
+}
+
+// Where the element is shown in the warehouse of the board shown
+QPoint PlayGroundBenchmark::warehousePos(const QString &element) const
+{
+  QSvgRenderer renderer(svgFile(m_playGround->currentGameboard()));
+  return m_playGround->mapFromScene(renderer.boundsOnElement(element).center());
+}
+
+// How many objects saving the board now writes
+int PlayGroundBenchmark::savedItems()
+{
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  if (!m_playGround->saveAs(&buffer))
+    return -1;
+  buffer.close();
+
+  SaveGameReader reader;
+  if (reader.open(&buffer) != SaveGameReader::NoError)
+    return -1;
+  int items = 0;
+  SaveGameReader::Item item;
+  while (!reader.atEnd() && reader.readItem(&item))
+    items++;
+  return items;
+}
+
+void PlayGroundBenchmark::toDrawContains_data()
+{
+  QTest::addColumn<QString>("element");
+  QTest::addColumn<QPointF>("relativePoint");
+
+  const QStringList names = objectNames(FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme)));
+  QTest::newRow("center") << names.first() << QPointF(0.5, 0.5);
+  QTest::newRow("corner") << names.first() << QPointF(0.01, 0.01);
+}
+
+void PlayGroundBenchmark::toDrawContains()
+{
+  QFETCH(QString, element);
+  QFETCH(QPointF, relativePoint);
+
+  Gameboard gameboard;
+  QVERIFY(gameboard.load(svgFile(FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme)))));
+  ToDraw item(&gameboard, gameboard.element(element));
+  // Measure the full hit test, not the background clipping of a stray item
+  item.setBeingDragged(true);
+
+  const QRectF bounds = item.unclippedRect();
+  const QPointF point(bounds.width() * relativePoint.x(), bounds.height() * relativePoint.y());
+  QBENCHMARK {
+    item.contains(point);
+  }
+}
+
+void PlayGroundBenchmark::warehousePick_data()
+{
+  QTest::addColumn<QString>("element");
+
+  const QStringList names = objectNames(FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme)));
+  QTest::newRow("first") << names.first();
+  QTest::newRow("last") << names.last();
+}
+
+void PlayGroundBenchmark::warehousePick()
+{
+  QFETCH(QString, element);
+
+  m_playGround->loadPlayGround(FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme)));
+
+  const QPoint pos = warehousePos(element);
+  QWidget *viewport = m_playGround->viewport();
+
+  QAction undo(nullptr);
+  m_playGround->connectUndoAction(&undo);
+
+  // Pick the item from the warehouse and drop it back in place
+  QBENCHMARK {
+    QTest::mousePress(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+    QTest::mouseRelease(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+    QTest::mousePress(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+    QTest::mouseRelease(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+    undo.trigger();
+  }
+}
+
+void PlayGroundBenchmark::loadPlayGround_data()
+{
+  QTest::addColumn<QString>("theme");
+
+  const QStringList dirs = FileFactory::locateAll(QStringLiteral("pics"));
+  for (const QString &dir : dirs)
+  {
+    const QStringList fileNames = QDir(dir).entryList(QStringList() << QStringLiteral("*.theme"));
+    for (const QString &file : fileNames)
+      QTest::newRow(qPrintable(QFileInfo(file).baseName())) << dir + '/' + file;
+  }
+}
+
+void PlayGroundBenchmark::loadPlayGround()
+{
+  QFETCH(QString, theme);
+
+  QBENCHMARK {
+    QVERIFY(m_playGround->loadPlayGround(theme));
+  }
+}
+
+void PlayGroundBenchmark::registerPlayGrounds()
+{
+  QBENCHMARK {
+    m_callbacks.gameboards.clear();
+    m_playGround->registerPlayGrounds();
+  }
+  QVERIFY(!m_callbacks.gameboards.isEmpty());
+}
+
+void PlayGroundBenchmark::saveLoadRoundTrip_data()
+{
+  QTest::addColumn<int>("items");
+
+  QTest::newRow("10") << 10;
+  QTest::newRow("1000") << 1000;
+  QTest::newRow("10000") << 10000;
+}
+
+void PlayGroundBenchmark::saveLoadRoundTrip()
+{
+  QFETCH(int, items);
+
+  const QString loadFile = writeSaveFile(items);
+  QVERIFY(!loadFile.isEmpty());
+  const QString saveFile = m_tempDir.path() + QStringLiteral("/saved%1.tuberling").arg(items);
+
+  QBENCHMARK {
+    QCOMPARE(m_playGround->loadFrom(loadFile), PlayGround::NoError);
+    QVERIFY(m_playGround->saveAs(saveFile));
+  }
+}
+
+void PlayGroundBenchmark::getPicture()
+{
+  m_playGround->loadFrom(writeSaveFile(1000));
+
+  QBENCHMARK {
+    const QPixmap picture = m_playGround->getPicture();
+    Q_UNUSED(picture);
+  }
+}
+
+// Not a benchmark: the object held is only drawn by the view, it must not get lost
+void PlayGroundBenchmark::saveWhileHolding()
+{
+  QCOMPARE(m_playGround->loadFrom(writeSaveFile(10)), PlayGround::NoError);
+  QCOMPARE(savedItems(), 10);
+
+  // a click picks it, it stays held until the next one
+  const QStringList names = objectNames(m_playGround->currentGameboard());
+  const QPoint pos = warehousePos(names.first());
+  QWidget *viewport = m_playGround->viewport();
+  QTest::mouseClick(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+  QCOMPARE(savedItems(), 11);
+  // and still held, once
+  QCOMPARE(savedItems(), 11);
+
+  // loading the board again drops it
+  QVERIFY(m_playGround->loadPlayGround(m_playGround->currentGameboard()));
+  QCOMPARE(savedItems(), 10);
+  m_playGround->reset();
+}
+
+void PlayGroundBenchmark::dragNewItem_data()
+{
+  QTest::addColumn<int>("items");
+
+  QTest::newRow("10") << 10;
+  QTest::newRow("1000") << 1000;
+  QTest::newRow("10000") << 10000;
+}
+
+// The cost of the moves of a drag on a full board, what is drawn in the
+// end included
+void PlayGroundBenchmark::dragNewItem()
+{
+  QFETCH(int, items);
+
+  QCOMPARE(m_playGround->loadFrom(writeSaveFile(items)), PlayGround::NoError);
+  const QStringList names = objectNames(m_playGround->currentGameboard());
+  const QPoint pos = warehousePos(names.first());
+  QWidget *viewport = m_playGround->viewport();
+  QTest::mouseClick(viewport, Qt::LeftButton, Qt::NoModifier, pos);
+
+  const QRect area = viewport->rect().adjusted(50, 50, -50, -50);
+  QBENCHMARK {
+    for (int i = 0; i < 100; ++i)
+    {
+      const QPoint to(area.left() + (i * 37) % area.width(), area.top() + (i * 53) % area.height());
+      // QTest::mouseMove() only moves the cursor on widgets
+      QMouseEvent move(QEvent::MouseMove, to, Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+      QApplication::sendEvent(viewport, &move);
+    }
+    QApplication::processEvents();
+    viewport->repaint();
+  }
+
+  // loading the board again drops it
+  QVERIFY(m_playGround->loadPlayGround(m_playGround->currentGameboard()));
+  m_playGround->reset();
+}
+
+void PlayGroundBenchmark::playSoundLookup()
+{
+  // A sound the language does not have is looked for once and never reaches the player
+  Gameboard gameboard;
+  const int element = gameboard.element(QStringLiteral("no-such-object"));
+  gameboard.addObject(element, QStringLiteral("no-such-sound"), 1);
+  const int sound = gameboard.sound(element);
+  QBENCHMARK {
+    m_soundFactory->playSound(&gameboard, sound);
+  }
+}
+
+// Bytes in use on the heap, -1 if we cannot tell
+static qint64 allocatedBytes()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+  return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+  return mallinfo().uordblks;
+#else
+  return -1;
+#endif
+}
+
+// What an object laid down costs, including its undo command and its share of the scene index
+void PlayGroundBenchmark::memoryPerItem()
+{
+  if (allocatedBytes() < 0)
+    QSKIP("Heap usage is only known with glibc");
+
+  const int items = 10000;
+  QVERIFY(m_playGround->loadPlayGround(FileFactory::locate(QLatin1String( "pics/" ) + QLatin1String(defaultTheme))));
+  m_playGround->reset();
+
+  const qint64 before = allocatedBytes();
+  m_playGround->fillWithRandomItems(items);
+  const qint64 after = allocatedBytes();
+  m_playGround->reset();
+
+  QTest::setBenchmarkResult(qreal(after - before) / items, QTest::BytesAllocated);
+}
+
+// Turns the results of QTest's xml logger into a flat JSON report
+static bool writeJsonReport(const QString &xmlFileName, const QString &jsonFileName)
+{
+  QFile xmlFile(xmlFileName);
+  if (!xmlFile.open(QIODevice::ReadOnly))
+    return false;
+
+  QJsonObject report;
+  QJsonArray results;
+  QString function;
+  QXmlStreamReader xml(&xmlFile);
+  while (!xml.atEnd())
+  {
+    if (xml.readNext() != QXmlStreamReader::StartElement)
+      continue;
+
+    const QXmlStreamAttributes attributes = xml.attributes();
+    if (xml.name() == QLatin1String("TestCase"))
+    {
+      report.insert(QStringLiteral("testCase"), attributes.value(QLatin1String("name")).toString());
+    }
+    else if (xml.name() == QLatin1String("QtVersion"))
+    {
+      report.insert(QStringLiteral("qtVersion"), xml.readElementText());
+    }
+    else if (xml.name() == QLatin1String("TestFunction"))
+    {
+      function = attributes.value(QLatin1String("name")).toString();
+    }
+    else if (xml.name() == QLatin1String("BenchmarkResult"))
+    {
+      const double value = attributes.value(QLatin1String("value")).toDouble();
+      const int iterations = attributes.value(QLatin1String("iterations")).toInt();
+      QJsonObject result;
+      result.insert(QStringLiteral("function"), function);
+      result.insert(QStringLiteral("tag"), attributes.value(QLatin1String("tag")).toString());
+      result.insert(QStringLiteral("metric"), attributes.value(QLatin1String("metric")).toString());
+      result.insert(QStringLiteral("value"), value);
+      result.insert(QStringLiteral("iterations"), iterations);
+      result.insert(QStringLiteral("valuePerIteration"), iterations > 0 ? value / iterations : value);
+      results.append(result);
+    }
+  }
+  if (xml.hasError())
+    return false;
+  report.insert(QStringLiteral("results"), results);
+
+  QFile jsonFile(jsonFileName);
+  if (!jsonFile.open(QIODevice::WriteOnly))
+    return false;
+  jsonFile.write(QJsonDocument(report).toJson());
+  return jsonFile.error() == QFile::NoError;
+}
+
+// Same as QTEST_MAIN plus "-json <file>" (or $KTUBERLING_BENCHMARK_JSON)
+// to get a machine readable report for tracking regressions
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  // So that FileFactory finds our data
+  app.setApplicationName(QStringLiteral("ktuberling"));
+
+  QStringList args = app.arguments();
+  QString jsonFileName = QFile::decodeName(qgetenv("KTUBERLING_BENCHMARK_JSON"));
+  const int jsonIndex = args.indexOf(QStringLiteral("-json"));
+  if (jsonIndex != -1 && jsonIndex + 1 < args.count())
+  {
+    jsonFileName = args.at(jsonIndex + 1);
+    args.erase(args.begin() + jsonIndex, args.begin() + jsonIndex + 2);
+  }
+
+  PlayGroundBenchmark benchmark;
+  if (jsonFileName.isEmpty())
+    return QTest::qExec(&benchmark, args);
+
+  QTemporaryFile xmlFile;
+  if (!xmlFile.open())
+    return 1;
+  args << QStringLiteral("-o") << xmlFile.fileName() + QStringLiteral(",xml");
+  args << QStringLiteral("-o") << QStringLiteral("-,txt");
+
+  const int result = QTest::qExec(&benchmark, args);
+  if (!writeJsonReport(xmlFile.fileName(), jsonFileName))
+  {
+    qWarning() << "Could not write" << jsonFileName;
+    return result ? result : 1;
+  }
+  return result;
+}
+
+#include "playgroundbenchmark.moc"
@@ -0,0 +1,342 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* What the caches draw against what QSvgRenderer draws */
+
+#include <algorithm>
+
+#include <QApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTransform>
+#include <QtMath>
+
+#include "filefactory.h"
+#include "gameboard.h"
+#include "gameboardrepository.h"
+#include "headlesscallbacks.h"
+#include "imagediff.h"
+#include "playground.h"
+#include "savegame.h"
+
+// Largest channel difference a pixel may have, but on the antialiased
+// edges of the shapes, which sprites drawn at a fractional position move
+static const int tolerance = 4;
+
+// Part of the pixels of an object, or of the whole picture, allowed past
+// it off the edges
+static const double maxOverToleranceRatio = 0.002;
+
+struct SceneItem
+{
+  QPointF pos;
+  int element;
+  qreal z;
+};
+
+class RenderRegressionTest : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void imageDiff();
+  void render_data();
+  void render();
+
+private:
+  QVector<SceneItem> referenceScene(Gameboard *gameboard, const QString &scene) const;
+  QVector<SceneItem> readScene(Gameboard *gameboard, const QString &saveFile) const;
+  void compare(const QString &name, const QImage &image, const QImage &expected, Gameboard *gameboard, const QVector<SceneItem> &items) const;
+  QString writeSaveFile(const QString &themeFile, Gameboard *gameboard, const QVector<SceneItem> &items, const QString &name);
+  QImage renderReference(Gameboard *gameboard, QVector<SceneItem> items, const QSize &size) const;
+  void saveFailure(const QString &name, const QImage &image, const QImage &expected, const ImageDiff &diff) const;
+
+  HeadlessCallbacks m_callbacks;
+  PlayGround *m_playGround;
+  QTemporaryDir m_tempDir;
+};
+
+void RenderRegressionTest::initTestCase()
+{
+  QVERIFY(m_tempDir.isValid());
+  QVERIFY2(!FileFactory::locateAll(QStringLiteral("pics")).isEmpty(), "Themes not found, is XDG_DATA_DIRS set?");
+
+  m_playGround = new PlayGround(&m_callbacks);
+  m_playGround->resize(640, 480);
+  m_playGround->show();
+  QVERIFY(QTest::qWaitForWindowExposed(m_playGround));
+}
+
+void RenderRegressionTest::cleanupTestCase()
+{
+  delete m_playGround;
+}
+
+// The fast path has to find what the plain one finds, whatever the alignment
+void RenderRegressionTest::imageDiff()
+{
+  QImage a(37, 11, QImage::Format_ARGB32_Premultiplied);
+  for (int y = 0; y < a.height(); ++y)
+    for (int x = 0; x < a.width(); ++x)
+      a.setPixel(x, y, qRgba(x * 7, y * 23, (x * y) % 256, 255));
+
+  const ImageDiff same = diffImages(a, a, tolerance);
+  QCOMPARE(same.maxDifference, 0);
+  QCOMPARE(same.pixelsOverTolerance, qint64(0));
+  QCOMPARE(same.meanDifference, 0.0);
+
+  QImage b = a;
+  b.setPixel(0, 0, qRgba(255, 0, 0, 255));
+  b.setPixel(17, 3, qRgba(0, 0, 0, 255));
+  b.setPixel(36, 10, qRgba(3, 230, 100, 255));
+  const ImageDiff fast = diffImages(a, b, tolerance);
+  const ImageDiff plain = diffImagesScalar(a, b, tolerance);
+  QCOMPARE(fast.maxDifference, plain.maxDifference);
+  QCOMPARE(fast.pixelsOverTolerance, plain.pixelsOverTolerance);
+  QCOMPARE(fast.meanDifference, plain.meanDifference);
+  QCOMPARE(fast.heatmap, plain.heatmap);
+  QVERIFY(fast.pixelsOverTolerance > 0);
+}
+
+// Generated layouts for every theme, and the saved tuberlings of SCENES_DIR
+void RenderRegressionTest::render_data()
+{
+  QTest::addColumn<QString>("theme");
+  QTest::addColumn<QString>("scene");
+  QTest::addColumn<QString>("saveFile");
+
+  const QStringList dirs = FileFactory::locateAll(QStringLiteral("pics"));
+  for (const QString &dir : dirs)
+  {
+    const QStringList fileNames = QDir(dir).entryList(QStringList() << QStringLiteral("*.theme"));
+    for (const QString &file : fileNames)
+    {
+      const QString baseName = QFileInfo(file).baseName();
+      QTest::newRow(qPrintable(baseName + QLatin1String("-warehouse"))) << dir + '/' + file << QStringLiteral("warehouse") << QString();
+      QTest::newRow(qPrintable(baseName + QLatin1String("-crowded"))) << dir + '/' + file << QStringLiteral("crowded") << QString();
+    }
+  }
+
+  const QDir scenes(QStringLiteral(SCENES_DIR));
+  const QStringList saveFiles = scenes.entryList(QStringList() << QStringLiteral("*.tuberling"));
+  for (const QString &file : saveFiles)
+  {
+    QFile device(scenes.filePath(file));
+    SaveGameReader reader;
+    const QString theme = reader.open(&device) == SaveGameReader::NoError
+                          ? FileFactory::locate(QLatin1String( "pics/" ) + reader.gameboard()) : QString();
+    QTest::newRow(qPrintable(QFileInfo(file).baseName())) << theme << QFileInfo(file).baseName() << scenes.filePath(file);
+  }
+}
+
+// Every object of the warehouse once, or many of them overlapping and
+// crossing the edges of the background
+QVector<SceneItem> RenderRegressionTest::referenceScene(Gameboard *gameboard, const QString &scene) const
+{
+  const QVector<int> &objects = gameboard->objects();
+  const QRectF background = gameboard->backgroundRect();
+  QVector<SceneItem> items;
+  if (scene == QLatin1String("warehouse"))
+  {
+    const int columns = qCeil(qSqrt(objects.count()));
+    const qreal cellWidth = background.width() / columns;
+    const qreal cellHeight = background.height() / columns;
+    for (int i = 0; i < objects.count(); ++i)
+    {
+      const SceneItem item = { background.topLeft() + QPointF((i % columns) * cellWidth, (i / columns) * cellHeight), objects.at(i), qreal(i + 1) };
+      items << item;
+    }
+  }
+  else
+  {
+    for (int i = 0; i < 3 * objects.count(); ++i)
+    {
+      const int element = objects.at(i % objects.count());
+      const QSizeF size = gameboard->geometry(element).size;
+      const QPointF spot(background.left() + (i * 37) % qMax(1, int(background.width())),
+                         background.top() + (i * 53) % qMax(1, int(background.height())));
+      const SceneItem item = { spot - QPointF(size.width() / 2, size.height() / 2), element, qreal(i + 1) };
+      items << item;
+    }
+  }
+  return items;
+}
+
+// What a saved tuberling holds, as SaveGameReader reads it
+QVector<SceneItem> RenderRegressionTest::readScene(Gameboard *gameboard, const QString &saveFile) const
+{
+  QVector<SceneItem> items;
+  QFile file(saveFile);
+  SaveGameReader reader;
+  if (reader.open(&file) != SaveGameReader::NoError || reader.needsScaling())
+    return items;
+
+  SaveGameReader::Item saved;
+  while (!reader.atEnd() && reader.readItem(&saved))
+  {
+    const SceneItem item = { saved.pos, gameboard->element(saved.element), saved.z };
+    items << item;
+  }
+  return items;
+}
+
+// Through a save file, so that loading is part of what is checked
+QString RenderRegressionTest::writeSaveFile(const QString &themeFile, Gameboard *gameboard, const QVector<SceneItem> &items, const QString &name)
+{
+  const QString fileName = m_tempDir.path() + QLatin1Char('/') + name + QStringLiteral(".tuberling");
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return QString();
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_5);
+  out << QStringLiteral("KTuberlingSaveGameV4");
+  out << QFileInfo(themeFile).fileName();
+  for (const SceneItem &item : items)
+  {
+    out << item.pos;
+    out << gameboard->elementId(item.element);
+    out << item.z;
+  }
+  return fileName;
+}
+
+// What the scene would look like without any of the caches
+QImage RenderRegressionTest::renderReference(Gameboard *gameboard, QVector<SceneItem> items, const QSize &size) const
+{
+  std::stable_sort(items.begin(), items.end(), [](const SceneItem &a, const SceneItem &b) {
+    return a.z < b.z;
+  });
+
+  const QRectF background = gameboard->backgroundRect();
+  QSvgRenderer *renderer = gameboard->renderer();
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  painter.scale(size.width() / background.width(), size.height() / background.height());
+  painter.translate(-background.topLeft());
+  renderer->render(&painter, QRectF(QPointF(0, 0), gameboard->defaultSize()));
+  painter.setClipRect(background);
+  for (const SceneItem &item : items)
+    renderer->render(&painter, gameboard->elementId(item.element), QRectF(item.pos, gameboard->geometry(item.element).size));
+  painter.end();
+  return image;
+}
+
+// Next to the test binary, for a look at what went wrong
+void RenderRegressionTest::saveFailure(const QString &name, const QImage &image, const QImage &expected, const ImageDiff &diff) const
+{
+  const QString dir = QDir::currentPath() + QStringLiteral("/renderregression");
+  QDir().mkpath(dir);
+  image.save(dir + QLatin1Char('/') + name + QStringLiteral("-actual.png"));
+  expected.save(dir + QLatin1Char('/') + name + QStringLiteral("-expected.png"));
+  diff.heatmap.save(dir + QLatin1Char('/') + name + QStringLiteral("-diff.png"));
+}
+
+// Each object on its own, so that one drawn wrong is not lost in a big picture
+void RenderRegressionTest::compare(const QString &name, const QImage &image, const QImage &expected, Gameboard *gameboard, const QVector<SceneItem> &items) const
+{
+  QCOMPARE(image.size(), expected.size());
+  const ImageDiff diff = diffImages(image, expected, tolerance);
+  const QImage edges = edgeMask(expected, tolerance);
+
+  const QRectF background = gameboard->backgroundRect();
+  QTransform toImage;
+  toImage.scale(image.width() / background.width(), image.height() / background.height());
+  toImage.translate(-background.x(), -background.y());
+  for (const SceneItem &item : items)
+  {
+    const QRect region = toImage.mapRect(QRectF(item.pos, gameboard->geometry(item.element).size)).toAlignedRect().intersected(image.rect());
+    const qint64 over = pixelsOverTolerance(diff, edges, region);
+    if (over > qint64(region.width()) * region.height() * maxOverToleranceRatio)
+    {
+      saveFailure(name, image, expected, diff);
+      QFAIL(qPrintable(QStringLiteral("%1 at %2,%3: %4 pixels differ by more than %5")
+                       .arg(gameboard->elementId(item.element)).arg(item.pos.x()).arg(item.pos.y()).arg(over).arg(tolerance)));
+    }
+  }
+
+  const qint64 over = pixelsOverTolerance(diff, edges, image.rect());
+  if (over > qint64(image.width()) * image.height() * maxOverToleranceRatio)
+  {
+    saveFailure(name, image, expected, diff);
+    QFAIL(qPrintable(QStringLiteral("%1 pixels differ by more than %2, mean difference %3")
+                     .arg(over).arg(tolerance).arg(diff.meanDifference)));
+  }
+}
+
+void RenderRegressionTest::render()
+{
+  QFETCH(QString, theme);
+  QFETCH(QString, scene);
+  QFETCH(QString, saveFile);
+
+  QVERIFY2(!theme.isEmpty(), "Theme of the saved tuberling not found");
+  const QSharedPointer<Gameboard> gameboard = GameboardRepository::self()->gameboard(theme);
+  QVERIFY(gameboard);
+  const QString name = saveFile.isEmpty() ? QFileInfo(theme).baseName() + QLatin1Char('-') + scene : scene;
+  QVector<SceneItem> items;
+  if (saveFile.isEmpty())
+  {
+    items = referenceScene(gameboard.data(), scene);
+    saveFile = writeSaveFile(theme, gameboard.data(), items, name);
+    QVERIFY(!saveFile.isEmpty());
+  }
+  else
+  {
+    items = readScene(gameboard.data(), saveFile);
+    QVERIFY2(!items.isEmpty(), "Not a saved tuberling of the current format");
+  }
+
+  QCOMPARE(m_playGround->loadFrom(saveFile), PlayGround::NoError);
+
+  // the first picture may show a stand in for the level of detail it needs
+  m_playGround->getImage();
+  QTRY_VERIFY(gameboard->pendingBackgroundLevels().isEmpty());
+  const QImage image = m_playGround->getImage();
+  QVERIFY(!image.isNull());
+
+  compare(name, image, renderReference(gameboard.data(), items, image.size()), gameboard.data(), items);
+  if (QTest::currentTestFailed()) return;
+
+  // Golden images catch what changes both paths, e.g. a new Qt or an edited theme
+  const QString goldenFile = QStringLiteral(GOLDEN_DIR "/") + name + QStringLiteral(".png");
+  if (qEnvironmentVariableIsSet("KTUBERLING_UPDATE_GOLDEN"))
+  {
+    QDir().mkpath(QStringLiteral(GOLDEN_DIR));
+    QVERIFY(image.save(goldenFile));
+    return;
+  }
+
+  // the comparison with the reference drawing above still ran
+  QImage golden;
+  if (!golden.load(goldenFile))
+    QSKIP(qPrintable(QStringLiteral("No golden image %1, write it with KTUBERLING_UPDATE_GOLDEN=1").arg(goldenFile)));
+  compare(name + QStringLiteral("-golden"), image, golden, gameboard.data(), items);
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  // So that FileFactory finds our data
+  app.setApplicationName(QStringLiteral("ktuberling"));
+  RenderRegressionTest test;
+  return QTest::qExec(&test, argc, argv);
+}
+
+#include "renderregressiontest.moc"
@@ -0,0 +1,248 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The render service as seen by a client on its socket */
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QSet>
+#include <QTest>
+
+#include "filefactory.h"
+#include "gameboard.h"
+#include "gameboardrepository.h"
+#include "headlesscallbacks.h"
+#include "playground.h"
+#include "renderservice.h"
+#include "savegame.h"
+
+// The first request loads the gameboard
+static const int replyTimeout = 30000;
+
+struct Reply
+{
+  quint32 id;
+  quint8 status;
+  QByteArray data;
+};
+
+class RenderServiceTest : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void render();
+  void defaultSize();
+  void badRequests();
+  void pipelined();
+  void stats();
+
+private:
+  QByteArray tuberling(const QString &gameboard, const QStringList &elements) const;
+  void send(quint32 id, const QString &command, const QByteArray &payload, const QSize &size = QSize());
+  bool readReply(Reply *reply);
+
+  RenderService *m_service = nullptr;
+  QLocalSocket *m_socket = nullptr;
+  HeadlessCallbacks m_callbacks;
+  PlayGround *m_playGround = nullptr;
+  QSharedPointer<Gameboard> m_gameboard;
+  QString m_themeFile;
+};
+
+void RenderServiceTest::initTestCase()
+{
+  m_themeFile = FileFactory::locate(QStringLiteral("pics/default_theme.theme"));
+  QVERIFY2(!m_themeFile.isEmpty(), "Themes not found, is XDG_DATA_DIRS set?");
+  m_gameboard = GameboardRepository::self()->gameboard(m_themeFile);
+  QVERIFY(m_gameboard);
+  QVERIFY(m_gameboard->objects().count() >= 3);
+
+  const QString name = QStringLiteral("ktuberling-renderservicetest-%1").arg(QCoreApplication::applicationPid());
+  m_service = new RenderService();
+  QVERIFY2(m_service->listen(name), qPrintable(m_service->errorString()));
+
+  m_socket = new QLocalSocket();
+  m_socket->connectToServer(name);
+  QTRY_COMPARE(m_socket->state(), QLocalSocket::ConnectedState);
+
+  // the same drawing, without the service in between
+  m_playGround = new PlayGround(&m_callbacks);
+}
+
+void RenderServiceTest::cleanupTestCase()
+{
+  delete m_socket;
+  delete m_service;
+  delete m_playGround;
+}
+
+QByteArray RenderServiceTest::tuberling(const QString &gameboard, const QStringList &elements) const
+{
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_4_5);
+  out << QString::fromLatin1(saveGameText);
+  out << gameboard;
+  const QRectF background = m_gameboard->backgroundRect();
+  for (int i = 0; i < elements.count(); ++i)
+  {
+    out << background.topLeft() + QPointF(background.width() * (i + 1) / (elements.count() + 2), background.height() / 3);
+    out << elements.at(i);
+    out << qreal(i + 1);
+  }
+  return data;
+}
+
+void RenderServiceTest::send(quint32 id, const QString &command, const QByteArray &payload, const QSize &size)
+{
+  QDataStream out(m_socket);
+  out.setVersion(QDataStream::Qt_5_9);
+  out << id << command << payload << size;
+}
+
+// Never waits, the service answers from this thread
+bool RenderServiceTest::readReply(Reply *reply)
+{
+  QDataStream in(m_socket);
+  in.setVersion(QDataStream::Qt_5_9);
+  in.startTransaction();
+  in >> reply->id >> reply->status >> reply->data;
+  return in.commitTransaction();
+}
+
+void RenderServiceTest::render()
+{
+  QStringList elements;
+  for (int i = 0; i < 3; ++i)
+    elements << m_gameboard->elementId(m_gameboard->objects().at(i));
+  const QByteArray payload = tuberling(QStringLiteral("default_theme.theme"), elements);
+  const QSize size(320, 240);
+
+  send(1, QStringLiteral("render"), payload, size);
+  Reply reply;
+  QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+  QCOMPARE(reply.id, quint32(1));
+  QCOMPARE(int(reply.status), int(RenderService::Ok));
+
+  QImage image;
+  QVERIFY(image.loadFromData(reply.data, "PNG"));
+  QCOMPARE(image.size(), size);
+
+  QByteArray data = payload;
+  QBuffer buffer(&data);
+  QCOMPARE(m_playGround->loadFrom(&buffer), PlayGround::NoError);
+  const QImage expected = m_playGround->getImage(size);
+  QCOMPARE(image.convertToFormat(QImage::Format_ARGB32), expected.convertToFormat(QImage::Format_ARGB32));
+}
+
+void RenderServiceTest::defaultSize()
+{
+  send(2, QStringLiteral("render"), tuberling(QStringLiteral("default_theme.theme"), QStringList()));
+  Reply reply;
+  QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+  QCOMPARE(int(reply.status), int(RenderService::Ok));
+
+  QImage image;
+  QVERIFY(image.loadFromData(reply.data, "PNG"));
+  QCOMPARE(image.size(), m_gameboard->backgroundRect().size().toSize());
+}
+
+void RenderServiceTest::badRequests()
+{
+  const QString element = m_gameboard->elementId(m_gameboard->objects().first());
+  send(3, QStringLiteral("render"), QByteArray("not a tuberling"));
+  send(4, QStringLiteral("render"), tuberling(QStringLiteral("../default_theme.theme"), QStringList() << element));
+  send(5, QStringLiteral("render"), tuberling(QStringLiteral("default_theme.theme"), QStringList() << QStringLiteral("no such object")));
+  send(6, QStringLiteral("render"), tuberling(QStringLiteral("default_theme.theme"), QStringList() << element), QSize(100000, 10));
+  send(7, QStringLiteral("paint"), QByteArray());
+
+  QSet<quint32> ids;
+  for (int i = 0; i < 5; ++i)
+  {
+    Reply reply;
+    QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+    QCOMPARE(int(reply.status), int(RenderService::BadRequest));
+    QVERIFY(!reply.data.isEmpty());
+    ids << reply.id;
+  }
+  QCOMPARE(ids, QSet<quint32>() << 3 << 4 << 5 << 6 << 7);
+
+  // still serving
+  send(8, QStringLiteral("render"), tuberling(QStringLiteral("default_theme.theme"), QStringList() << element), QSize(64, 48));
+  Reply reply;
+  QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+  QCOMPARE(reply.id, quint32(8));
+  QCOMPARE(int(reply.status), int(RenderService::Ok));
+}
+
+// Requests sent at once all get their reply, whatever the order
+void RenderServiceTest::pipelined()
+{
+  const QString element = m_gameboard->elementId(m_gameboard->objects().first());
+  QSet<quint32> sent;
+  for (quint32 id = 100; id < 116; ++id)
+  {
+    send(id, QStringLiteral("render"), tuberling(QStringLiteral("default_theme.theme"), QStringList() << element), QSize(200 + id, 150));
+    sent << id;
+  }
+
+  QSet<quint32> received;
+  while (received.count() < sent.count())
+  {
+    Reply reply;
+    QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+    QCOMPARE(int(reply.status), int(RenderService::Ok));
+    QImage image;
+    QVERIFY(image.loadFromData(reply.data, "PNG"));
+    QCOMPARE(image.width(), int(200 + reply.id));
+    received << reply.id;
+  }
+  QCOMPARE(received, sent);
+}
+
+void RenderServiceTest::stats()
+{
+  send(200, QStringLiteral("stats"), QByteArray());
+  Reply reply;
+  QTRY_VERIFY_WITH_TIMEOUT(readReply(&reply), replyTimeout);
+  QCOMPARE(reply.id, quint32(200));
+  QCOMPARE(int(reply.status), int(RenderService::Ok));
+
+  const QJsonObject stats = QJsonDocument::fromJson(reply.data).object();
+  QCOMPARE(stats.value(QStringLiteral("queueDepth")).toInt(), 0);
+  QCOMPARE(stats.value(QStringLiteral("encoding")).toInt(), 0);
+  QVERIFY(stats.value(QStringLiteral("maxQueueDepth")).toInt() >= 1);
+  // the ones of render(), defaultSize(), badRequests() and pipelined()
+  QCOMPARE(stats.value(QStringLiteral("rendered")).toInt(), 19);
+  QCOMPARE(stats.value(QStringLiteral("failed")).toInt(), 5);
+
+  const QJsonObject latency = stats.value(QStringLiteral("latency")).toObject();
+  QCOMPARE(latency.value(QStringLiteral("count")).toInt(), 24);
+  QVERIFY(latency.value(QStringLiteral("p50Ms")).toDouble() <= latency.value(QStringLiteral("p95Ms")).toDouble());
+  QVERIFY(latency.value(QStringLiteral("p95Ms")).toDouble() <= latency.value(QStringLiteral("maxMs")).toDouble());
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  // So that FileFactory finds our data
+  app.setApplicationName(QStringLiteral("ktuberling"));
+  RenderServiceTest test;
+  return QTest::qExec(&test, argc, argv);
+}
+
+#include "renderservicetest.moc"
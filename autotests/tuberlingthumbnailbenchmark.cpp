@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Benchmarks of the thumbnailer, per file as a file manager asks for them */
+
+#include <QDataStream>
+#include <QDomDocument>
+#include <QFile>
+#include <QImage>
+#include <QStandardPaths>
+#include <QSvgRenderer>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "savegame.h"
+#include "tuberlingthumbnail.h"
+
+static const char *defaultTheme = "default_theme.theme";
+
+class TuberlingThumbnailBenchmark : public QObject
+{
+  Q_OBJECT
+
+private Q_SLOTS:
+  void initTestCase();
+
+  void create_data();
+  void create();
+  void createFirst_data();
+  void createFirst();
+  void createMixedSizes();
+
+private:
+  QString writeSaveFile(int items);
+
+  QString m_themeFile;
+  QTemporaryDir m_tempDir;
+};
+
+// The thumbnailer looks the themes up itself, not through FileFactory
+static QString locateTheme(const QString &fileName)
+{
+  return QStandardPaths::locate(QStandardPaths::GenericDataLocation, QLatin1String( "ktuberling/pics/" ) + fileName);
+}
+
+void TuberlingThumbnailBenchmark::initTestCase()
+{
+  QVERIFY(m_tempDir.isValid());
+
+  m_themeFile = locateTheme(QLatin1String(defaultTheme));
+  QVERIFY2(!m_themeFile.isEmpty(), "Themes not found, is XDG_DATA_DIRS set?");
+}
+
+// Writes a save game of the default theme with the given number of items
+QString TuberlingThumbnailBenchmark::writeSaveFile(int items)
+{
+  QFile themeFile(m_themeFile);
+  QDomDocument document;
+  if (!themeFile.open(QIODevice::ReadOnly) || !document.setContent(&themeFile))
+    return QString();
+
+  QStringList names;
+  const QDomNodeList objects = document.documentElement().elementsByTagName(QStringLiteral( "object" ));
+  for (int i = 0; i < objects.count(); ++i)
+    names << objects.item(i).toElement().attribute(QStringLiteral( "name" ));
+  QSvgRenderer renderer(locateTheme(document.documentElement().attribute(QStringLiteral( "gameboard" ))));
+  const QRectF background = renderer.boundsOnElement(QStringLiteral( "background" ));
+  if (names.isEmpty() || background.isEmpty())
+    return QString();
+
+  const QString fileName = m_tempDir.path() + QStringLiteral("/items%1.tuberling").arg(items);
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return QString();
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_5);
+  out << QString::fromLatin1(saveGameText);
+  out << QString::fromLatin1(defaultTheme);
+  for (int i = 0; i < items; ++i)
+  {
+    // Spread the items deterministically over the background
+    const QPointF pos(background.left() + (i * 37) % int(background.width()),
+                      background.top() + (i * 53) % int(background.height()));
+    out << pos;
+    out << names.at(i % names.count());
+    out << qreal(i + 1);
+  }
+  return fileName;
+}
+
+void TuberlingThumbnailBenchmark::create_data()
+{
+  QTest::addColumn<int>("items");
+  QTest::addColumn<int>("size");
+
+  QTest::newRow("10 items, 128") << 10 << 128;
+  QTest::newRow("10 items, 256") << 10 << 256;
+  QTest::newRow("100 items, 256") << 100 << 256;
+  QTest::newRow("1000 items, 256") << 1000 << 256;
+}
+
+// One file after the other with the same creator, as the thumbnailer
+// process goes through a folder
+void TuberlingThumbnailBenchmark::create()
+{
+  QFETCH(int, items);
+  QFETCH(int, size);
+
+  const QString fileName = writeSaveFile(items);
+  QVERIFY(!fileName.isEmpty());
+
+  TuberlingThumbnail creator;
+  QImage image;
+  QVERIFY(creator.create(fileName, size, size, image));
+  QVERIFY(!image.isNull());
+  QVERIFY(image.width() <= size && image.height() <= size);
+
+  QBENCHMARK {
+    creator.create(fileName, size, size, image);
+  }
+}
+
+void TuberlingThumbnailBenchmark::createFirst_data()
+{
+  QTest::addColumn<int>("items");
+
+  QTest::newRow("10 items") << 10;
+  QTest::newRow("1000 items") << 1000;
+}
+
+// The first file of a thumbnailer process, the theme is loaded and rasterized for it
+void TuberlingThumbnailBenchmark::createFirst()
+{
+  QFETCH(int, items);
+
+  const QString fileName = writeSaveFile(items);
+  QVERIFY(!fileName.isEmpty());
+
+  QImage image;
+  QBENCHMARK {
+    TuberlingThumbnail creator;
+    QVERIFY(creator.create(fileName, 256, 256, image));
+  }
+}
+
+// File managers ask for several sizes, each change rasterizes the theme again
+void TuberlingThumbnailBenchmark::createMixedSizes()
+{
+  const QString fileName = writeSaveFile(100);
+  QVERIFY(!fileName.isEmpty());
+
+  TuberlingThumbnail creator;
+  QImage image;
+  QBENCHMARK {
+    QVERIFY(creator.create(fileName, 128, 128, image));
+    QVERIFY(creator.create(fileName, 256, 256, image));
+  }
+}
+
+QTEST_MAIN(TuberlingThumbnailBenchmark)
+
+#include "tuberlingthumbnailbenchmark.moc"
@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The gameboard picture below all the objects */
+
+#include "backgrounditem.h"
+
+#include <cmath>
+
+#include <QFutureWatcher>
+#include <QPainter>
+#include <QPaintDevice>
+#include <QStyleOptionGraphicsItem>
+#include <QSvgRenderer>
+#include <QtConcurrentRun>
+#include <QtMath>
+
+#include "gameboard.h"
+#include "instrumentation.h"
+#include "performancecounters.h"
+#include "themebundle.h"
+
+// Past this many pixels a level costs more memory than rendering the SVG costs time
+static const int maxLevelPixels = 4096 * 4096;
+
+// The bundle is held until the render is done, the SVG data is in its map
+static QImage renderLevel(const QString &svgFile, const QSharedPointer<ThemeBundle> &bundle, const QSize &size)
+{
+  // renderers cannot be shared between threads
+  QSvgRenderer renderer;
+  if (bundle) renderer.load(bundle->svg());
+  else renderer.load(svgFile);
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  renderer.render(&painter);
+  painter.end();
+  return image;
+}
+
+BackgroundItem::BackgroundItem(Gameboard *gameboard)
+ : m_gameboard(gameboard)
+{
+  setSharedRenderer(gameboard->renderer());
+  // we do our own caching, per level of detail instead of per device transform
+  setCacheMode(QGraphicsItem::NoCache);
+  setPos(QPoint(0,0));
+  setZValue(0);
+}
+
+BackgroundItem::~BackgroundItem()
+{
+  m_gameboard->pendingBackgroundLevels().subtract(m_requestedLevels);
+}
+
+void BackgroundItem::gameboardChanged()
+{
+  setSharedRenderer(m_gameboard->renderer()); // picks up the new size
+  update();
+}
+
+QSize BackgroundItem::levelSize(int level) const
+{
+  return (QSizeF(m_gameboard->defaultSize()) * qPow(2, level / 2.0)).toSize();
+}
+
+void BackgroundItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  Instrumentation::Scope scope("BackgroundItem::paint");
+
+  const qreal deviceScale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) * painter->device()->devicePixelRatioF();
+  const int level = qCeil(2 * std::log2(qMax(deviceScale, qreal(0.01))));
+  const QSize size = levelSize(level);
+  if (size.isEmpty() || size.width() * qint64(size.height()) > maxLevelPixels)
+  {
+    QGraphicsSvgItem::paint(painter, option, widget);
+    return;
+  }
+
+  const QPixmap pixmap = levelPixmap(level);
+  painter->save();
+  painter->setRenderHint(QPainter::SmoothPixmapTransform);
+  painter->drawPixmap(boundingRect(), pixmap, QRectF(pixmap.rect()));
+  painter->restore();
+}
+
+QPixmap BackgroundItem::levelPixmap(int level)
+{
+  QMap<int, QPixmap> &levels = m_gameboard->backgroundLevels();
+  QMap<int, QPixmap>::const_iterator it = levels.constFind(level);
+  if (it != levels.constEnd())
+  {
+    PerformanceCounters::self()->cacheHit(PerformanceCounters::BackgroundLevelCache);
+    return it.value();
+  }
+  PerformanceCounters::self()->cacheMiss(PerformanceCounters::BackgroundLevelCache);
+
+  // Nothing to stand in yet, e.g. the very first paint
+  if (levels.isEmpty())
+  {
+    const QPixmap pixmap = QPixmap::fromImage(renderLevel(m_gameboard->svgFile(), m_gameboard->bundle(), levelSize(level)));
+    m_gameboard->addBackgroundLevel(level, pixmap);
+    return pixmap;
+  }
+
+  requestLevel(level);
+
+  // Meanwhile the closest level, preferably a sharper one
+  QMap<int, QPixmap>::const_iterator above = levels.lowerBound(level);
+  if (above != levels.constEnd()) return above.value();
+  return (--levels.constEnd()).value();
+}
+
+void BackgroundItem::requestLevel(int level)
+{
+  QSet<int> &pendingLevels = m_gameboard->pendingBackgroundLevels();
+  if (pendingLevels.contains(level)) return;
+  pendingLevels << level;
+  m_requestedLevels << level;
+
+  // renders started before the gameboard is loaded again are stale
+  const int generation = m_gameboard->generation();
+  QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+  connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, level, generation]
+  {
+    watcher->deleteLater();
+    m_gameboard->pendingBackgroundLevels().remove(level);
+    m_requestedLevels.remove(level);
+    if (generation != m_gameboard->generation())
+    {
+      // the next paint asks for it again
+      update();
+      return;
+    }
+    // other views of the gameboard may show other levels, the memory
+    // budget trims them, see Gameboard::evict()
+    m_gameboard->addBackgroundLevel(level, QPixmap::fromImage(watcher->result()));
+    update();
+  });
+  watcher->setFuture(QtConcurrent::run(renderLevel, m_gameboard->svgFile(), m_gameboard->bundle(), levelSize(level)));
+}
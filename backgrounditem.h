@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The gameboard picture below all the objects */
+
+#ifndef BACKGROUNDITEM_H
+#define BACKGROUNDITEM_H
+
+#include <QGraphicsSvgItem>
+#include <QPixmap>
+#include <QSet>
+
+class Gameboard;
+
+// Keeps the gameboard rasterized at a few levels of detail, half an octave
+// apart, so that zooming only scales pixmaps. Missing levels are rendered
+// in the background while the nearest one available stands in. The levels
+// belong to the gameboard, all the documents showing it share them.
+class BackgroundItem : public QGraphicsSvgItem
+{
+  public:
+    explicit BackgroundItem(Gameboard *gameboard);
+    ~BackgroundItem();
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    // The gameboard was loaded again, its size may be another one
+    void gameboardChanged();
+
+  private:
+    QPixmap levelPixmap(int level);
+    void requestLevel(int level);
+    QSize levelSize(int level) const;
+
+    Gameboard *m_gameboard;
+    QSet<int> m_requestedLevels;		// pending because of this item, others may ask for them again once it is gone
+};
+
+#endif
@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Reads and writes whole documents without blocking the GUI thread */
+
+#include "filetransfer.h"
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <kio/job.h>
+
+struct ReadResult
+{
+  bool ok;
+  QByteArray data;
+};
+
+static ReadResult readFile(const QString &fileName)
+{
+  ReadResult result;
+  QFile file(fileName);
+  result.ok = file.open(QIODevice::ReadOnly);
+  if (result.ok)
+  {
+    result.data = file.readAll();
+    result.ok = file.error() == QFile::NoError;
+  }
+  return result;
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &data)
+{
+  QSaveFile file(fileName);
+  return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+// One thread, so that writes to the same file end in the order they were
+// asked for. Its destructor waits for the ones left when the program ends.
+class WritePool : public QThreadPool
+{
+  public:
+    WritePool()
+    {
+      setMaxThreadCount(1);
+    }
+};
+
+static QThreadPool *writePool()
+{
+  static WritePool pool;
+  return &pool;
+}
+
+FileTransfer::FileTransfer(const QUrl &url, QObject *parent)
+ : QObject(parent), m_url(url), m_killed(false)
+{
+}
+
+FileTransfer *FileTransfer::get(const QUrl &url, QObject *parent)
+{
+  FileTransfer *transfer = new FileTransfer(url, parent);
+  transfer->startGet();
+  return transfer;
+}
+
+FileTransfer *FileTransfer::put(const QByteArray &data, const QUrl &url, QObject *parent)
+{
+  FileTransfer *transfer = new FileTransfer(url, parent);
+  transfer->startPut(data);
+  return transfer;
+}
+
+QUrl FileTransfer::url() const
+{
+  return m_url;
+}
+
+QByteArray FileTransfer::data() const
+{
+  return m_data;
+}
+
+void FileTransfer::kill()
+{
+  if (m_killed) return;
+  m_killed = true;
+  if (m_job) m_job->kill(KJob::Quietly);
+  // a read or write in flight has its own copies, its watcher goes with us
+  deleteLater();
+}
+
+void FileTransfer::startGet()
+{
+  if (m_url.isLocalFile())
+  {
+    // slow disks and network mounts block the thread reading them
+    QFutureWatcher<ReadResult> *watcher = new QFutureWatcher<ReadResult>(this);
+    connect(watcher, &QFutureWatcher<ReadResult>::finished, this, [this, watcher]
+    {
+      const ReadResult result = watcher->result();
+      m_data = result.data;
+      finish(result.ok);
+    });
+    watcher->setFuture(QtConcurrent::run(readFile, m_url.toLocalFile()));
+    return;
+  }
+
+  // The bytes are collected as they come, there is no temporary file
+  KIO::TransferJob *job = KIO::get(m_url, KIO::NoReload, KIO::DefaultFlags);
+  m_job = job;
+  connect(job, &KIO::TransferJob::data, this, [this](KIO::Job *, const QByteArray &chunk)
+  {
+    m_data.append(chunk);
+  });
+  connect(job, &KJob::result, this, [this, job]
+  {
+    finish(!job->error());
+  });
+}
+
+void FileTransfer::startPut(const QByteArray &data)
+{
+  if (m_url.isLocalFile())
+  {
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher]
+    {
+      finish(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(writePool(), writeFile, m_url.toLocalFile(), data));
+    return;
+  }
+
+  KIO::StoredTransferJob *job = KIO::storedPut(data, m_url, -1, KIO::Overwrite);
+  m_job = job;
+  connect(job, &KJob::result, this, [this, job]
+  {
+    finish(!job->error());
+  });
+}
+
+void FileTransfer::finish(bool ok)
+{
+  if (m_killed) return;
+  emit finished(ok);
+  deleteLater();
+}
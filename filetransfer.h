@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Reads and writes whole documents without blocking the GUI thread */
+
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+
+class KJob;
+
+// Local files are read in the thread pool and written with QSaveFile in a
+// thread of their own, one after the other, so that the last save of a
+// file wins. The others go through KIO, with its progress and cancel UI.
+// Either way finished() comes once and the transfer deletes itself then.
+class FileTransfer : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static FileTransfer *get(const QUrl &url, QObject *parent = nullptr);
+    static FileTransfer *put(const QByteArray &data, const QUrl &url, QObject *parent = nullptr);
+
+    QUrl url() const;
+    // What get() read, once finished
+    QByteArray data() const;
+
+    // Nothing comes anymore and the transfer deletes itself. A local write
+    // under way still ends, QSaveFile writes the whole file or nothing.
+    void kill();
+
+  Q_SIGNALS:
+    void finished(bool ok);
+
+  private:
+    FileTransfer(const QUrl &url, QObject *parent);
+
+    void startGet();
+    void startPut(const QByteArray &data);
+    void finish(bool ok);
+
+    QUrl m_url;
+    QByteArray m_data;
+    QPointer<KJob> m_job;			// for the files that are not local
+    bool m_killed;
+};
+
+#endif
@@ -0,0 +1,414 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Data shared by all the objects laid down on one gameboard */
+
+#include "gameboard.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QCoreApplication>
+#include <QPainter>
+
+#include "performancecounters.h"
+#include "themebundle.h"
+
+// Tells the sprites of every load of every gameboard apart, a gameboard
+// may take the address of one freed before
+static QAtomicInt lastSpriteId;
+
+static qint64 pixmapBytes(const QPixmap &pixmap)
+{
+  return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+// The element pixmaps of all the gameboards. Not QPixmapCache, which cannot
+// tell how much it holds nor be trimmed from outside.
+class SpriteCache : public MemoryBudget::Cache
+{
+  public:
+    SpriteCache()
+    {
+      m_pixmaps.setMaxCost(INT_MAX);
+      MemoryBudget::self()->registerCache("sprites", MemoryBudget::RenderElement, this);
+      // pixmaps must go before the application does
+      qAddPostRoutine(clear);
+    }
+
+    ~SpriteCache()
+    {
+      MemoryBudget::self()->unregisterCache(this);
+    }
+
+    static SpriteCache *self()
+    {
+      static SpriteCache instance;
+      return &instance;
+    }
+
+    QPixmap *find(const QString &key)
+    {
+      return m_pixmaps.object(key);
+    }
+
+    void insert(const QString &key, const QPixmap &pixmap)
+    {
+      m_pixmaps.insert(key, new QPixmap(pixmap), qMax(1, int(pixmapBytes(pixmap) / 1024)));
+      MemoryBudget::self()->checkBudget();
+    }
+
+    qint64 memoryUsed() const override
+    {
+      return qint64(m_pixmaps.totalCost()) * 1024;
+    }
+
+    // the least recently used ones go first
+    qint64 evict(qint64 bytes) override
+    {
+      const int before = m_pixmaps.totalCost();
+      m_pixmaps.setMaxCost(qMax(qint64(0), before - (bytes + 1023) / 1024));
+      m_pixmaps.setMaxCost(INT_MAX);
+      return qint64(before - m_pixmaps.totalCost()) * 1024;
+    }
+
+  private:
+    static void clear()
+    {
+      self()->m_pixmaps.clear();
+    }
+
+    QCache<QString, QPixmap> m_pixmaps;	// cost in kilobytes
+};
+
+Gameboard::Gameboard()
+ : m_generation(0), m_spriteId(0), m_backgroundColor(Qt::white), m_soundLanguage(-1), m_lastBackgroundLevel(0), m_budgeted(false)
+{
+}
+
+Gameboard::~Gameboard()
+{
+  if (m_budgeted)
+    MemoryBudget::self()->unregisterCache(this);
+}
+
+bool Gameboard::load(const QString &svgFile, const QSharedPointer<ThemeBundle> &bundle)
+{
+  // a failed load empties the renderer, do not lose the board being shown
+  // because its file is still being written
+  if (m_generation > 0)
+  {
+    QSvgRenderer check;
+    if (!(bundle ? check.load(bundle->svg()) : check.load(svgFile)))
+      return false;
+  }
+
+  if (!(bundle ? m_renderer.load(bundle->svg()) : m_renderer.load(svgFile)))
+    return false;
+
+  m_generation++;
+  m_spriteId = lastSpriteId.fetchAndAddRelaxed(1) + 1;
+  m_masks.clear();
+  m_backgroundLevels.clear();
+  m_svgFile = svgFile;
+  m_bundle = bundle;
+  m_defaultSize = m_renderer.defaultSize();
+  m_backgroundRect = m_renderer.boundsOnElement(QStringLiteral( "background" ));
+  for (int element = 0; element < m_geometries.count(); ++element)
+  {
+    Geometry &geometry = m_geometries[element];
+    geometry.bounds = m_renderer.boundsOnElement(m_elementIds.at(element));
+    updateGeometry(geometry);
+  }
+  return true;
+}
+
+QSvgRenderer *Gameboard::renderer()
+{
+  return &m_renderer;
+}
+
+QString Gameboard::svgFile() const
+{
+  return m_svgFile;
+}
+
+QSharedPointer<ThemeBundle> Gameboard::bundle() const
+{
+  return m_bundle;
+}
+
+int Gameboard::generation() const
+{
+  return m_generation;
+}
+
+QColor Gameboard::backgroundColor() const
+{
+  return m_backgroundColor;
+}
+
+void Gameboard::setBackgroundColor(const QColor &color)
+{
+  m_backgroundColor = color;
+}
+
+QSize Gameboard::defaultSize() const
+{
+  return m_defaultSize;
+}
+
+QRectF Gameboard::backgroundRect() const
+{
+  return m_backgroundRect;
+}
+
+int Gameboard::element(const QString &elementId)
+{
+  QHash<QString, int>::const_iterator it = m_elements.constFind(elementId);
+  if (it != m_elements.constEnd())
+    return it.value();
+
+  const int element = m_elementIds.count();
+  Geometry geometry;
+  geometry.bounds = m_renderer.boundsOnElement(elementId);
+  geometry.scale = 1;
+  updateGeometry(geometry);
+
+  m_elementIds << elementId;
+  m_geometries << geometry;
+  m_sounds << -1;
+  m_elements.insert(elementId, element);
+  return element;
+}
+
+int Gameboard::findElement(const QString &elementId) const
+{
+  return m_elements.value(elementId, -1);
+}
+
+QString Gameboard::elementId(int element) const
+{
+  return m_elementIds.value(element);
+}
+
+const Gameboard::Geometry &Gameboard::geometry(int element) const
+{
+  static const Geometry noGeometry = { QRectF(), QSizeF(), 1, QRectF() };
+  if (element < 0 || element >= m_geometries.count()) return noGeometry;
+  return m_geometries.at(element);
+}
+
+void Gameboard::setScale(int element, qreal scale)
+{
+  Geometry &geometry = m_geometries[element];
+  geometry.scale = scale;
+  updateGeometry(geometry);
+}
+
+void Gameboard::clearObjects()
+{
+  m_objects.clear();
+  m_objectsByName.clear();
+  m_sounds.fill(-1);
+}
+
+void Gameboard::addObject(int element, const QString &sound, qreal scale)
+{
+  int soundId = -1;
+  if (!sound.isEmpty())
+  {
+    QHash<QString, int>::const_iterator it = m_soundIds.constFind(sound);
+    if (it != m_soundIds.constEnd())
+    {
+      soundId = it.value();
+    }
+    else
+    {
+      soundId = m_soundNames.count();
+      m_soundNames << sound;
+      m_soundIds.insert(sound, soundId);
+    }
+  }
+
+  m_objects << element;
+  const QString &id = m_elementIds.at(element);
+  m_objectsByName.insert(std::lower_bound(m_objectsByName.begin(), m_objectsByName.end(), id,
+                                          [this](int other, const QString &name) { return m_elementIds.at(other) < name; }), element);
+  m_sounds[element] = soundId;
+  setScale(element, scale);
+}
+
+const QVector<int> &Gameboard::objects() const
+{
+  return m_objects;
+}
+
+// The object of the warehouse at pos, -1 if none. Where they overlap the
+// first one by name wins, as it always did.
+int Gameboard::objectAt(const QPointF &pos) const
+{
+  for (int element : m_objectsByName)
+  {
+    if (m_geometries.at(element).bounds.contains(pos))
+      return element;
+  }
+  return -1;
+}
+
+int Gameboard::sound(int element) const
+{
+  return m_sounds.value(element, -1);
+}
+
+QString Gameboard::soundName(int sound) const
+{
+  return m_soundNames.value(sound);
+}
+
+int Gameboard::soundCount() const
+{
+  return m_soundNames.count();
+}
+
+int Gameboard::soundLanguage() const
+{
+  return m_soundLanguage;
+}
+
+const QVector<QString> &Gameboard::soundFiles() const
+{
+  return m_soundFiles;
+}
+
+void Gameboard::setSoundFiles(int language, const QVector<QString> &files)
+{
+  m_soundLanguage = language;
+  m_soundFiles = files;
+}
+
+void Gameboard::updateGeometry(Geometry &geometry) const
+{
+  geometry.size = geometry.bounds.size() * geometry.scale;
+  geometry.clipRect = QRectF(0, 0, m_defaultSize.width() - geometry.size.width(), m_defaultSize.height() - geometry.size.height());
+}
+
+QPixmap Gameboard::elementPixmap(int element, const QSize &size)
+{
+  const QString key = QStringLiteral("ktuberling_%1_%2_%3x%4").arg(m_spriteId).arg(element).arg(size.width()).arg(size.height());
+
+  if (QPixmap *cached = SpriteCache::self()->find(key))
+  {
+    PerformanceCounters::self()->cacheHit(PerformanceCounters::ElementPixmapCache);
+    return *cached;
+  }
+  PerformanceCounters::self()->cacheMiss(PerformanceCounters::ElementPixmapCache);
+
+  QPixmap pixmap(size);
+  pixmap.fill(Qt::transparent);
+  QPainter painter(&pixmap);
+  m_renderer.render(&painter, elementId(element));
+  painter.end();
+
+  SpriteCache::self()->insert(key, pixmap);
+  return pixmap;
+}
+
+const QImage &Gameboard::elementMask(int element, const QSize &size)
+{
+  static const QImage noMask;
+  if (element < 0 || element >= m_elementIds.count()) return noMask;
+  if (m_masks.count() < m_elementIds.count()) m_masks.resize(m_elementIds.count());
+
+  QImage &mask = m_masks[element];
+  if (mask.size() != size && !size.isEmpty())
+  {
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    // don't need quality here
+    painter.setRenderHints(QPainter::Antialiasing|QPainter::TextAntialiasing|QPainter::SmoothPixmapTransform, false);
+    m_renderer.render(&painter, elementId(element));
+    painter.end();
+    mask = image.convertToFormat(QImage::Format_Alpha8);
+    MemoryBudget::self()->checkBudget();
+  }
+  return mask;
+}
+
+QMap<int, QPixmap> &Gameboard::backgroundLevels()
+{
+  return m_backgroundLevels;
+}
+
+QSet<int> &Gameboard::pendingBackgroundLevels()
+{
+  return m_pendingBackgroundLevels;
+}
+
+void Gameboard::addBackgroundLevel(int level, const QPixmap &pixmap)
+{
+  // only now, gameboards may have been loaded in another thread
+  if (!m_budgeted)
+  {
+    MemoryBudget::self()->registerCache("background levels", MemoryBudget::RenderGameboard, this);
+    m_budgeted = true;
+  }
+
+  m_backgroundLevels.insert(level, pixmap);
+  m_lastBackgroundLevel = level;
+  MemoryBudget::self()->checkBudget();
+}
+
+qint64 Gameboard::memoryUsed() const
+{
+  qint64 used = 0;
+  for (const QPixmap &level : m_backgroundLevels)
+    used += pixmapBytes(level);
+  for (const QImage &mask : m_masks)
+    used += qint64(mask.bytesPerLine()) * mask.height();
+  return used;
+}
+
+qint64 Gameboard::memoryEvictable() const
+{
+  qint64 used = 0;
+  for (QMap<int, QPixmap>::const_iterator it = m_backgroundLevels.constBegin(); it != m_backgroundLevels.constEnd(); ++it)
+  {
+    if (it.key() != m_lastBackgroundLevel)
+      used += pixmapBytes(it.value());
+  }
+  for (const QImage &mask : m_masks)
+    used += qint64(mask.bytesPerLine()) * mask.height();
+  return used;
+}
+
+// The farthest from the last one go first, they are the least likely to be asked for again
+qint64 Gameboard::evict(qint64 bytes)
+{
+  qint64 freed = 0;
+  while (freed < bytes && m_backgroundLevels.count() > 1)
+  {
+    QMap<int, QPixmap>::iterator first = m_backgroundLevels.begin();
+    QMap<int, QPixmap>::iterator last = --m_backgroundLevels.end();
+    QMap<int, QPixmap>::iterator farthest = qAbs(first.key() - m_lastBackgroundLevel) > qAbs(last.key() - m_lastBackgroundLevel) ? first : last;
+    if (farthest.key() == m_lastBackgroundLevel) break;
+    freed += pixmapBytes(farthest.value());
+    m_backgroundLevels.erase(farthest);
+  }
+  // made again at the next hit test
+  for (int element = 0; freed < bytes && element < m_masks.count(); ++element)
+  {
+    freed += qint64(m_masks.at(element).bytesPerLine()) * m_masks.at(element).height();
+    m_masks[element] = QImage();
+  }
+  return freed;
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Data shared by all the objects laid down on one gameboard: the catalog
+   of its elements and sounds, by small integer ids, and their rendering */
+
+#ifndef GAMEBOARD_H
+#define GAMEBOARD_H
+
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QPixmap>
+#include <QRectF>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSvgRenderer>
+#include <QVector>
+
+#include "memorybudget.h"
+
+class ThemeBundle;
+
+class Gameboard : public MemoryBudget::Cache
+{
+  public:
+    // Everything the hot paths need to know about an element, computed once
+    struct Geometry
+    {
+      QRectF bounds;		// in the gameboard, unscaled
+      QSizeF size;		// of the objects showing it, scaled
+      qreal scale;
+      QRectF clipRect;		// where the top left corner of such an object may go
+    };
+
+    Gameboard();
+    ~Gameboard();
+
+    // A gameboard can be created and loaded in another thread, as long as it
+    // only gets used in the GUI thread afterwards.
+    // Loading again, e.g. when the file changed, keeps the element indices
+    // and leaves everything as it was if the new file cannot be read. With a
+    // bundle the SVG comes from there, svgFile only tells where it would
+    // be otherwise.
+    bool load(const QString &svgFile, const QSharedPointer<ThemeBundle> &bundle = QSharedPointer<ThemeBundle>());
+    QSvgRenderer *renderer();
+    QString svgFile() const;
+    QSharedPointer<ThemeBundle> bundle() const;
+    int generation() const;
+
+    QColor backgroundColor() const;
+    void setBackgroundColor(const QColor &color);
+
+    QSize defaultSize() const;
+    QRectF backgroundRect() const;
+
+    // Element ids are interned, an index stays valid as long as the gameboard lives
+    int element(const QString &elementId);
+    int findElement(const QString &elementId) const;
+    QString elementId(int element) const;
+
+    const Geometry &geometry(int element) const;
+    void setScale(int element, qreal scale);
+
+    // The objects of the warehouse, in the order of the theme. Where they
+    // overlap, objectAt() gives the one the theme lists first.
+    void clearObjects();
+    void addObject(int element, const QString &sound, qreal scale);
+    const QVector<int> &objects() const;
+    int objectAt(const QPointF &pos) const;
+
+    // Sound names are interned too, -1 for an element without sound
+    int sound(int element) const;
+    QString soundName(int sound) const;
+    int soundCount() const;
+
+    // The sound files by sound id for one language, see SoundFactory::playSound()
+    int soundLanguage() const;
+    const QVector<QString> &soundFiles() const;
+    void setSoundFiles(int language, const QVector<QString> &files);
+
+    // The element rendered at the given device size, shared by all its objects
+    QPixmap elementPixmap(int element, const QSize &size);
+
+    // The alpha of the element at the given size, for hit testing. Only
+    // the size last asked for is kept, it only changes with the scale.
+    const QImage &elementMask(int element, const QSize &size);
+
+    // The whole gameboard by level of detail, shared by all the backgrounds
+    // showing it, see BackgroundItem. Emptied by load(), levels get added
+    // through addBackgroundLevel() so that they count in the memory budget.
+    QMap<int, QPixmap> &backgroundLevels();
+    QSet<int> &pendingBackgroundLevels();
+    void addBackgroundLevel(int level, const QPixmap &pixmap);
+
+    // All the masks and background levels. The one added last, most likely
+    // on screen, is not evictable.
+    qint64 memoryUsed() const override;
+    qint64 memoryEvictable() const override;
+    qint64 evict(qint64 bytes) override;
+
+  private:
+    void updateGeometry(Geometry &geometry) const;
+
+    QSvgRenderer m_renderer;
+    QString m_svgFile;
+    QSharedPointer<ThemeBundle> m_bundle;
+    int m_generation;				// how many times it was loaded
+    int m_spriteId;				// of this load, in the keys of its sprites
+    QSize m_defaultSize;
+    QRectF m_backgroundRect;
+    QColor m_backgroundColor;
+    QVector<QString> m_elementIds;
+    QVector<Geometry> m_geometries;		// indexed by element
+    QVector<int> m_sounds;			// indexed by element
+    QHash<QString, int> m_elements;		// element id -> index
+    QVector<int> m_objects;
+    QVector<int> m_objectsByName;		// the order objectAt() looks in
+    QVector<QString> m_soundNames;
+    QHash<QString, int> m_soundIds;		// sound name -> index
+    int m_soundLanguage;
+    QVector<QString> m_soundFiles;		// indexed by sound, for m_soundLanguage
+    QVector<QImage> m_masks;			// indexed by element, Format_Alpha8
+    QMap<int, QPixmap> m_backgroundLevels;
+    QSet<int> m_pendingBackgroundLevels;	// being rendered in another thread
+    int m_lastBackgroundLevel;
+    bool m_budgeted;				// registered with the memory budget
+};
+
+#endif
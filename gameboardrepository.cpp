@@ -0,0 +1,393 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The installed themes and their gameboards, for all the play grounds of the process */
+
+#include "gameboardrepository.h"
+
+#include <kconfig.h>
+#include <kconfiggroup.h>
+#include <qdebug.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include "filefactory.h"
+#include "gameboard.h"
+#include "instrumentation.h"
+#include "performancecounters.h"
+#include "playground.h"
+#include "themebundle.h"
+
+// How long theme files must stay untouched before reloading them (ms)
+static const int themeReloadDelay = 200;
+
+// Loads in the background go untimed, Instrumentation is for the GUI thread
+static const char *scopeName(const char *name)
+{
+  return QThread::currentThread() == QCoreApplication::instance()->thread() ? name : nullptr;
+}
+
+GameboardRepository *GameboardRepository::self()
+{
+  static GameboardRepository instance;
+  return &instance;
+}
+
+GameboardRepository::GameboardRepository()
+ : m_scanned(false)
+{
+  m_reloadTimer.setSingleShot(true);
+  m_reloadTimer.setInterval(themeReloadDelay);
+  connect(&m_reloadTimer, &QTimer::timeout, this, &GameboardRepository::reloadChangedThemes);
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &GameboardRepository::themePathChanged);
+  connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &GameboardRepository::themePathChanged);
+}
+
+void GameboardRepository::registerThemes(PlayGroundCallbacks *callbacks, QObject *context)
+{
+  scanThemes();
+
+  QMap<QString, QString> sortedByName;
+  for (auto it = m_themes.constBegin(); it != m_themes.constEnd(); ++it)
+    sortedByName.insertMulti(it.value().name, it.key());
+
+  for(auto it = sortedByName.constBegin(); it != sortedByName.constEnd(); ++it) {
+    callbacks->registerGameboard(it.key(), it.value(), m_themes.value(it.value()).gameboardFile);
+  }
+
+  for (const Registration &registration : m_registrations)
+  {
+    if (registration.callbacks == callbacks && registration.context == context)
+      return;
+  }
+  const Registration registration = { callbacks, context };
+  m_registrations << registration;
+}
+
+QSharedPointer<ThemeBundle> GameboardRepository::bundle(const QString &gameboardFile) const
+{
+  for (auto it = m_themes.constBegin(); it != m_themes.constEnd(); ++it)
+  {
+    if (it.value().gameboardFile == gameboardFile)
+      return it.value().bundle;
+  }
+  return QSharedPointer<ThemeBundle>();
+}
+
+QSharedPointer<Gameboard> GameboardRepository::gameboard(const QString &themeFile)
+{
+  QSharedPointer<Gameboard> gameboard = m_gameboards.value(themeFile).toStrongRef();
+  if (gameboard) return gameboard;
+
+  gameboard.reset(new Gameboard());
+  if (!loadGameboard(gameboard.data(), themeFile, m_themes.value(themeFile)))
+    return QSharedPointer<Gameboard>();
+  return adoptGameboard(themeFile, gameboard);
+}
+
+bool GameboardRepository::isLoaded(const QString &themeFile) const
+{
+  return !m_gameboards.value(themeFile).isNull();
+}
+
+QFuture<QSharedPointer<Gameboard>> GameboardRepository::loadInBackground(const QString &themeFile) const
+{
+  const Theme theme = m_themes.value(themeFile);
+  QThread *guiThread = thread();
+  return QtConcurrent::run([themeFile, theme, guiThread]() -> QSharedPointer<Gameboard> {
+    QSharedPointer<Gameboard> gameboard(new Gameboard());
+    if (!loadGameboard(gameboard.data(), themeFile, theme))
+      return QSharedPointer<Gameboard>();
+    // the renderer is a QObject, it has to live where it gets used
+    gameboard->renderer()->moveToThread(guiThread);
+    return gameboard;
+  });
+}
+
+QSharedPointer<Gameboard> GameboardRepository::adoptGameboard(const QString &themeFile, const QSharedPointer<Gameboard> &gameboard)
+{
+  const QSharedPointer<Gameboard> loaded = m_gameboards.value(themeFile).toStrongRef();
+  if (loaded || !gameboard) return loaded;
+
+  // forget the ones nobody holds any more
+  QHash<QString, QWeakPointer<Gameboard>>::iterator it = m_gameboards.begin();
+  while (it != m_gameboards.end())
+  {
+    if (it.value().isNull()) it = m_gameboards.erase(it);
+    else ++it;
+  }
+  m_gameboards.insert(themeFile, gameboard);
+  return gameboard;
+}
+
+// Find the themes, once
+void GameboardRepository::scanThemes()
+{
+  if (m_scanned) return;
+  m_scanned = true;
+
+  QSet<QString> list;
+  QHash<QString, QString> bundles;		// theme file -> the bundle next to it
+  const QStringList dirs = FileFactory::locateAll(QStringLiteral("pics"));
+  Q_FOREACH (const QString &dir, dirs)
+  {
+    const QStringList fileNames = QDir(dir).entryList(QStringList() << QStringLiteral("*.theme") << QStringLiteral("*.ktbundle"));
+    Q_FOREACH (const QString &file, fileNames)
+    {
+        if (file.endsWith(QLatin1String(".ktbundle")))
+          bundles.insert(dir + '/' + QFileInfo(file).completeBaseName() + QStringLiteral(".theme"), dir + '/' + file);
+        else
+          list << dir + '/' + file;
+    }
+  }
+
+  foreach(const QString &themeFile, list)
+  {
+    Theme theme;
+    const QString bundleFile = bundles.value(themeFile);
+    if ((!bundleFile.isEmpty() && readBundledTheme(bundleFile, themeFile, &theme)) || readTheme(themeFile, &theme))
+      m_themes.insert(themeFile, theme);
+  }
+
+  watchThemes();
+}
+
+// The name and gameboard of a theme file, false if it cannot be read
+bool GameboardRepository::readTheme(const QString &themeFile, Theme *theme) const
+{
+  QFile layoutFile(themeFile);
+  if (!layoutFile.open(QIODevice::ReadOnly)) return false;
+
+  // for finding out which theme makes startup slow, see --profile-startup
+  QElapsedTimer timer;
+  timer.start();
+  QDomDocument layoutDocument;
+  if (!layoutDocument.setContent(&layoutFile)) return false;
+
+  const qint64 parseTime = timer.nsecsElapsed();
+  QString desktop = layoutDocument.documentElement().attribute(QStringLiteral( "desktop" ));
+  KConfig c( FileFactory::locate( QLatin1String( "pics/" ) + desktop ) );
+  KConfigGroup cg = c.group("KTuberlingTheme");
+  theme->name = cg.readEntry("Name");
+  const qint64 configTime = timer.nsecsElapsed() - parseTime;
+  PerformanceCounters::self()->addThemeTiming(themeFile, parseTime, configTime);
+  // thumbnails are up to whoever shows them, and only when they are shown
+  QString gameboard = layoutDocument.documentElement().attribute(QStringLiteral( "gameboard" ));
+  theme->gameboardFile = FileFactory::locate(QLatin1String( "pics/" ) + gameboard);
+  return true;
+}
+
+// Whether one of the files next to the bundle was changed after it was written
+static bool isStale(const QString &bundleFile, const QString &themeFile, const QDomElement &playGroundElement)
+{
+  const QDateTime written = QFileInfo(bundleFile).lastModified();
+  const QString dir = QFileInfo(themeFile).path() + QLatin1Char('/');
+  const QStringList sources = QStringList() << themeFile
+                              << dir + playGroundElement.attribute(QStringLiteral( "desktop" ))
+                              << dir + playGroundElement.attribute(QStringLiteral( "gameboard" ));
+  for (const QString &source : sources)
+  {
+    const QFileInfo info(source);
+    if (info.exists() && info.lastModified() > written)
+    {
+      qWarning() << bundleFile << "is older than" << source << "- reading the theme files instead";
+      return true;
+    }
+  }
+  return false;
+}
+
+// Same as readTheme() with one mapped file, which stays open for loading the
+// gameboard. False when the theme was edited since the bundle was written.
+bool GameboardRepository::readBundledTheme(const QString &bundleFile, const QString &themeFile, Theme *theme) const
+{
+  QElapsedTimer timer;
+  timer.start();
+  QSharedPointer<ThemeBundle> bundle(new ThemeBundle());
+  if (!bundle->open(bundleFile)) return false;
+  QDomDocument layoutDocument;
+  if (!layoutDocument.setContent(bundle->theme())) return false;
+  if (isStale(bundleFile, themeFile, layoutDocument.documentElement())) return false;
+
+  const qint64 parseTime = timer.nsecsElapsed();
+  // the desktop file is installed next to the bundle, KConfig reads it the same way as readTheme()
+  const QString desktop = layoutDocument.documentElement().attribute(QStringLiteral( "desktop" ));
+  KConfig c( QFileInfo(themeFile).path() + QLatin1Char('/') + desktop );
+  KConfigGroup cg = c.group("KTuberlingTheme");
+  theme->name = cg.readEntry("Name");
+  const qint64 configTime = timer.nsecsElapsed() - parseTime;
+  PerformanceCounters::self()->addThemeTiming(themeFile, parseTime, configTime);
+  // bundles are installed next to the theme files, no need to look the SVG up
+  QString gameboard = layoutDocument.documentElement().attribute(QStringLiteral( "gameboard" ));
+  theme->gameboardFile = QFileInfo(themeFile).path() + '/' + gameboard;
+  theme->bundle = bundle;
+  return true;
+}
+
+// Background and draggable objects of a theme. A gameboard loaded
+// already stays as it was when the theme cannot be read.
+bool GameboardRepository::loadGameboard(Gameboard *gameboard, const QString &themeFile, const Theme &theme)
+{
+  const QSharedPointer<ThemeBundle> bundle = theme.bundle;
+  QFile layoutFile(themeFile);
+  if (!bundle && !layoutFile.open(QIODevice::ReadOnly)) return false;
+  QDomDocument layoutDocument;
+  {
+    Instrumentation::Scope scope(scopeName("loadPlayGround: parse layout"));
+    if (bundle ? !layoutDocument.setContent(bundle->theme()) : !layoutDocument.setContent(&layoutFile)) return false;
+  }
+
+  const QDomElement playGroundElement = layoutDocument.documentElement();
+  if (playGroundElement.elementsByTagName(QStringLiteral( "object" )).count() < 1)
+    return false;
+
+  {
+    Instrumentation::Scope scope(scopeName("loadPlayGround: load svg"));
+    const QString gameboardName = playGroundElement.attribute(QStringLiteral( "gameboard" ));
+    if (bundle ? !gameboard->load(theme.gameboardFile, bundle)
+               : !gameboard->load(FileFactory::locate( QLatin1String( "pics/" ) + gameboardName )))
+      return false;
+  }
+
+  QColor bgColor = QColor(playGroundElement.attribute(QStringLiteral( "bgcolor" ), QStringLiteral( "#fff" ) ) );
+  if (!bgColor.isValid())
+    bgColor = Qt::white;
+  gameboard->setBackgroundColor(bgColor);
+
+  {
+    Instrumentation::Scope scope(scopeName("loadPlayGround: objects"));
+    loadObjects(playGroundElement, gameboard, themeFile);
+  }
+  return true;
+}
+
+// Fill the catalog of the gameboard with the objects of the warehouse
+void GameboardRepository::loadObjects(const QDomElement &playGroundElement, Gameboard *gameboard, const QString &themeFile)
+{
+  gameboard->clearObjects();
+  const QDomNodeList objectsList = playGroundElement.elementsByTagName(QStringLiteral( "object" ));
+  for (int decoration = 0; decoration < objectsList.count(); decoration++)
+  {
+    const QDomElement objectElement = objectsList.item(decoration).toElement();
+
+    const QString &objectName = objectElement.attribute(QStringLiteral( "name" ));
+    if (gameboard->renderer()->elementExists(objectName))
+    {
+      gameboard->addObject(gameboard->element(objectName), objectElement.attribute(QStringLiteral( "sound" )),
+                           objectElement.attribute(QStringLiteral( "scale" ), QStringLiteral( "1" )).toDouble());
+    }
+    else
+    {
+      qWarning() << objectName << "does not exist. Check" << themeFile;
+    }
+  }
+}
+
+// Theme authors see their changes without restarting. The directories
+// tell about added and removed themes, the files about edited ones.
+void GameboardRepository::watchThemes()
+{
+  QStringList paths = FileFactory::locateAll(QStringLiteral("pics"));
+  for (auto it = m_themes.constBegin(); it != m_themes.constEnd(); ++it)
+    paths << it.key() << it.value().gameboardFile;
+
+  // files replaced on save are not watched any more, the others already are
+  const QStringList watched = m_watcher.files() + m_watcher.directories();
+  QStringList newPaths;
+  foreach (const QString &path, paths)
+  {
+    if (!path.isEmpty() && !watched.contains(path) && !newPaths.contains(path))
+      newPaths << path;
+  }
+  if (!newPaths.isEmpty())
+    m_watcher.addPaths(newPaths);
+}
+
+void GameboardRepository::themePathChanged(const QString &path)
+{
+  m_changedPaths << path;
+  m_reloadTimer.start();
+}
+
+// Only the themes touched by the changes get read again
+void GameboardRepository::reloadChangedThemes()
+{
+  Instrumentation::Scope scope("GameboardRepository::reloadChangedThemes");
+
+  QSet<QString> themes;
+  foreach (const QString &path, m_changedPaths)
+  {
+    if (QFileInfo(path).isDir())
+    {
+      QSet<QString> inDir;
+      const QStringList fileNames = QDir(path).entryList(QStringList() << QStringLiteral("*.theme"));
+      foreach (const QString &file, fileNames)
+        inDir << path + '/' + file;
+
+      foreach (const QString &theme, inDir)
+        if (!m_themes.contains(theme)) themes << theme;
+      for (auto it = m_themes.constBegin(); it != m_themes.constEnd(); ++it)
+        if (QFileInfo(it.key()).path() == path && !inDir.contains(it.key())) themes << it.key();
+    }
+    else
+    {
+      for (auto it = m_themes.constBegin(); it != m_themes.constEnd(); ++it)
+        if (it.key() == path || it.value().gameboardFile == path) themes << it.key();
+    }
+  }
+  m_changedPaths.clear();
+
+  foreach (const QString &theme, themes)
+    reloadTheme(theme);
+
+  watchThemes();
+}
+
+void GameboardRepository::reloadTheme(const QString &themeFile)
+{
+  // the ones whose context is gone do not want to know any more
+  QVector<Registration>::iterator it = m_registrations.begin();
+  while (it != m_registrations.end())
+  {
+    if (it->context.isNull()) it = m_registrations.erase(it);
+    else ++it;
+  }
+
+  if (!QFile::exists(themeFile))
+  {
+    // documents showing it keep their gameboard
+    if (m_themes.remove(themeFile))
+    {
+      for (const Registration &registration : m_registrations)
+        registration.callbacks->unregisterGameboard(themeFile);
+    }
+    return;
+  }
+
+  // half written, the next change will tell
+  Theme theme;
+  if (!readTheme(themeFile, &theme)) return;
+
+  m_themes.insert(themeFile, theme);
+  for (const Registration &registration : m_registrations)
+    registration.callbacks->registerGameboard(theme.name, themeFile, theme.gameboardFile);
+
+  QSharedPointer<Gameboard> gameboard = m_gameboards.value(themeFile).toStrongRef();
+  if (gameboard && loadGameboard(gameboard.data(), themeFile, theme))
+    emit gameboardChanged(themeFile);
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* The installed themes and their gameboards, for all the play grounds of the process */
+
+#ifndef GAMEBOARDREPOSITORY_H
+#define GAMEBOARDREPOSITORY_H
+
+#include <QFileSystemWatcher>
+#include <QFuture>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+#include <QWeakPointer>
+
+class QDomElement;
+class Gameboard;
+class PlayGroundCallbacks;
+class ThemeBundle;
+
+// However many documents show a theme, its SVG is parsed and its sprites
+// are cached once. Only to be used from the GUI thread.
+class GameboardRepository : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static GameboardRepository *self();
+
+    // Tells callbacks about all the themes now, and about the changes to
+    // them on disk for as long as context lives
+    void registerThemes(PlayGroundCallbacks *callbacks, QObject *context);
+
+    // The gameboard of a theme, null if the theme cannot be loaded.
+    // It stays loaded for as long as somebody holds it.
+    QSharedPointer<Gameboard> gameboard(const QString &themeFile);
+
+    // Whether somebody holds the gameboard of the theme, gameboard() is cheap then
+    bool isLoaded(const QString &themeFile) const;
+
+    // Same as gameboard() with the parsing and the SVG loading done in
+    // another thread. The result goes to adoptGameboard(), which gives the
+    // one loaded meanwhile instead if there is one.
+    QFuture<QSharedPointer<Gameboard>> loadInBackground(const QString &themeFile) const;
+    QSharedPointer<Gameboard> adoptGameboard(const QString &themeFile, const QSharedPointer<Gameboard> &gameboard);
+
+    // The bundle of the theme drawn on that SVG, null if it has none, see ThemeBundle
+    QSharedPointer<ThemeBundle> bundle(const QString &gameboardFile) const;
+
+  Q_SIGNALS:
+    // A gameboard somebody holds was loaded again in place, the element indices are the same
+    void gameboardChanged(const QString &themeFile);
+
+  private:
+    GameboardRepository();
+
+    struct Theme
+    {
+      QString name;
+      QString gameboardFile;			// the SVG
+      QSharedPointer<ThemeBundle> bundle;	// stands in for the files, until they are edited
+    };
+
+    struct Registration
+    {
+      PlayGroundCallbacks *callbacks;
+      QPointer<QObject> context;
+    };
+
+    void scanThemes();
+    bool readTheme(const QString &themeFile, Theme *theme) const;
+    bool readBundledTheme(const QString &bundleFile, const QString &themeFile, Theme *theme) const;
+    // These may run in another thread, theme being a copy
+    static bool loadGameboard(Gameboard *gameboard, const QString &themeFile, const Theme &theme);
+    static void loadObjects(const QDomElement &playGroundElement, Gameboard *gameboard, const QString &themeFile);
+
+    void watchThemes();
+    void themePathChanged(const QString &path);
+    void reloadChangedThemes();
+    void reloadTheme(const QString &themeFile);
+
+    bool m_scanned;
+    QHash<QString, Theme> m_themes;				// theme file -> what it says
+    QVector<Registration> m_registrations;			// who to tell about changed themes
+    QHash<QString, QWeakPointer<Gameboard>> m_gameboards;	// theme file -> gameboard
+    QFileSystemWatcher m_watcher;				// the theme directories, files and SVGs
+    QSet<QString> m_changedPaths;
+    QTimer m_reloadTimer;					// editors save in several steps
+};
+
+#endif
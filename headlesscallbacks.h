@@ -0,0 +1,34 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Callbacks for a play ground nobody sees, e.g. the render service's or the tests' */
+
+#ifndef HEADLESSCALLBACKS_H
+#define HEADLESSCALLBACKS_H
+
+#include "playground.h"
+
+// No sounds and no theme menus
+class HeadlessCallbacks : public PlayGroundCallbacks
+{
+public:
+  void playSound(Gameboard */*gameboard*/, int /*sound*/) override
+  {
+  }
+
+  void registerGameboard(const QString &/*menuText*/, const QString &/*boardFile*/, const QString &/*gameboardFile*/) override
+  {
+  }
+
+  void unregisterGameboard(const QString &/*boardFile*/) override
+  {
+  }
+};
+
+#endif
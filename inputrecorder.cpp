@@ -0,0 +1,191 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Recording of the mouse input of a play ground and replaying it back */
+
+#include "inputrecorder.h"
+
+#include <algorithm>
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QMouseEvent>
+#include <QStringList>
+#include <QTimer>
+
+#include "playground.h"
+
+static const char *inputRecordingText = "KTuberlingInputV1";
+
+enum { PressEvent, MoveEvent, ReleaseEvent };
+
+InputRecorder::InputRecorder()
+{
+}
+
+bool InputRecorder::start(const QString &fileName, PlayGround *playGround)
+{
+  m_file.setFileName(fileName);
+  if (!m_file.open(QIODevice::WriteOnly))
+    return false;
+
+  // Replays start from the very same board
+  QByteArray savedBoard;
+  QBuffer buffer(&savedBoard);
+  buffer.open(QIODevice::WriteOnly);
+  playGround->saveAs(&buffer);
+
+  m_stream.setDevice(&m_file);
+  m_stream.setVersion(QDataStream::Qt_5_0);
+  m_stream << QString::fromLatin1(inputRecordingText);
+  m_stream << QFileInfo(playGround->currentGameboard()).fileName();
+  m_stream << playGround->viewport()->size();
+  m_stream << savedBoard;
+  m_clock.start();
+
+  return m_stream.status() == QDataStream::Ok;
+}
+
+void InputRecorder::record(const QMouseEvent *event)
+{
+  quint8 type;
+  switch (event->type())
+  {
+    case QEvent::MouseButtonPress: type = PressEvent; break;
+    case QEvent::MouseMove: type = MoveEvent; break;
+    case QEvent::MouseButtonRelease: type = ReleaseEvent; break;
+    default: return;
+  }
+
+  m_stream << type;
+  m_stream << quint32(m_clock.elapsed());
+  m_stream << qint16(event->pos().x()) << qint16(event->pos().y());
+  m_stream << quint8(event->button()) << quint8(event->buttons());
+}
+
+
+
+InputReplayer::InputReplayer(PlayGround *playGround, QObject *parent)
+ : QObject(parent), m_playGround(playGround), m_nextEvent(0), m_asFastAsPossible(false)
+{
+}
+
+bool InputReplayer::load(const QString &fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+
+  QString magicText;
+  in >> magicText;
+  if (QLatin1String(inputRecordingText) != magicText)
+    return false;
+
+  in >> m_gameboard >> m_viewSize >> m_savedBoard;
+
+  m_events.clear();
+  while (!in.atEnd())
+  {
+    RecordedEvent event;
+    qint16 x, y;
+    in >> event.type >> event.time >> x >> y >> event.button >> event.buttons;
+    if (in.status() != QDataStream::Ok || event.type > ReleaseEvent)
+      return false;
+    event.pos = QPoint(x, y);
+    m_events << event;
+  }
+
+  return true;
+}
+
+void InputReplayer::start(bool asFastAsPossible)
+{
+  m_asFastAsPossible = asFastAsPossible;
+  m_nextEvent = 0;
+  for (QVector<qint64> &latencies : m_latencies)
+    latencies.clear();
+
+  QBuffer buffer(&m_savedBoard);
+  m_playGround->loadFrom(&buffer);
+
+  // The play ground may not be a window by itself, grow or shrink the one it lives in
+  QWidget *window = m_playGround->window();
+  window->resize(window->size() + m_viewSize - m_playGround->viewport()->size());
+  QCoreApplication::processEvents();
+
+  m_clock.start();
+  scheduleNext();
+}
+
+void InputReplayer::scheduleNext()
+{
+  if (m_nextEvent >= m_events.count())
+  {
+    emit finished();
+    return;
+  }
+
+  const qint64 delay = m_asFastAsPossible ? 0 : qMax(qint64(0), qint64(m_events[m_nextEvent].time) - m_clock.elapsed());
+  QTimer::singleShot(int(delay), this, &InputReplayer::replayNext);
+}
+
+void InputReplayer::replayNext()
+{
+  static const QEvent::Type eventTypes[] = { QEvent::MouseButtonPress, QEvent::MouseMove, QEvent::MouseButtonRelease };
+
+  const RecordedEvent &recorded = m_events[m_nextEvent++];
+  QWidget *viewport = m_playGround->viewport();
+  QMouseEvent event(eventTypes[recorded.type], recorded.pos, viewport->mapToGlobal(recorded.pos),
+                    Qt::MouseButton(recorded.button), Qt::MouseButtons(recorded.buttons), Qt::NoModifier);
+
+  // Latency is until the resulting repaint is done, not only the event handler
+  QElapsedTimer latency;
+  latency.start();
+  QCoreApplication::sendEvent(viewport, &event);
+  QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+  m_latencies[recorded.type] << latency.nsecsElapsed();
+
+  scheduleNext();
+}
+
+static QString latencyLine(const char *name, QVector<qint64> latencies)
+{
+  if (latencies.isEmpty())
+    return QStringLiteral("%1: no events").arg(QLatin1String(name));
+
+  std::sort(latencies.begin(), latencies.end());
+  qint64 total = 0;
+  for (qint64 latency : latencies)
+    total += latency;
+
+  return QStringLiteral("%1: %2 events, mean %3 ms, median %4 ms, p95 %5 ms, max %6 ms")
+           .arg(QLatin1String(name))
+           .arg(latencies.count())
+           .arg(total / 1e6 / latencies.count(), 0, 'f', 3)
+           .arg(latencies[latencies.count() / 2] / 1e6, 0, 'f', 3)
+           .arg(latencies[(latencies.count() * 95) / 100] / 1e6, 0, 'f', 3)
+           .arg(latencies.last() / 1e6, 0, 'f', 3);
+}
+
+QString InputReplayer::report() const
+{
+  QStringList lines;
+  lines << QStringLiteral("Replayed %1 events on %2 (%3x%4) in %5 ms")
+             .arg(m_events.count()).arg(m_gameboard)
+             .arg(m_viewSize.width()).arg(m_viewSize.height())
+             .arg(m_clock.elapsed());
+  lines << latencyLine("press", m_latencies[PressEvent]);
+  lines << latencyLine("move", m_latencies[MoveEvent]);
+  lines << latencyLine("release", m_latencies[ReleaseEvent]);
+  return lines.join(QLatin1Char('\n'));
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Recording of the mouse input of a play ground and replaying it back */
+
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QPoint>
+#include <QSize>
+#include <QVector>
+
+class QMouseEvent;
+
+class PlayGround;
+
+// File layout (QDataStream, Qt_5_0):
+//   QString magic, QString gameboard, QSize view size, QByteArray saved board,
+//   then per event: quint8 type, quint32 msecs, qint16 x, qint16 y, quint8 button, quint8 buttons
+class InputRecorder
+{
+  public:
+    InputRecorder();
+
+    bool start(const QString &fileName, PlayGround *playGround);
+    void record(const QMouseEvent *event);
+
+  private:
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+};
+
+class InputReplayer : public QObject
+{
+  Q_OBJECT
+
+  public:
+    explicit InputReplayer(PlayGround *playGround, QObject *parent = nullptr);
+
+    bool load(const QString &fileName);
+    // Either at the recorded pace or as fast as the play ground can take it
+    void start(bool asFastAsPossible);
+
+    QString report() const;
+
+  Q_SIGNALS:
+    void finished();
+
+  private:
+    void replayNext();
+    void scheduleNext();
+
+    struct RecordedEvent
+    {
+      quint8 type;
+      quint32 time;
+      QPoint pos;
+      quint8 button;
+      quint8 buttons;
+    };
+
+    PlayGround *m_playGround;
+    QString m_gameboard;
+    QSize m_viewSize;
+    QByteArray m_savedBoard;
+    QVector<RecordedEvent> m_events;
+    int m_nextEvent;
+    bool m_asFastAsPossible;
+    QElapsedTimer m_clock;
+    QVector<qint64> m_latencies[3];	// nanoseconds, per event type
+};
+
+#endif
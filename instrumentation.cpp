@@ -0,0 +1,175 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Timing and counting of the expensive parts, for finding out where lag comes from */
+
+#include "instrumentation.h"
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+// Do not let a forgotten trace eat all the memory
+static const int maxPendingEvents = 1000000;
+
+static void writeTraceOnExit()
+{
+  if (Instrumentation::self()->isEnabled())
+    Instrumentation::self()->writeTrace();
+}
+
+Instrumentation *Instrumentation::self()
+{
+  static Instrumentation instance;
+  return &instance;
+}
+
+Instrumentation::Instrumentation()
+ : m_enabled(false), m_session(0), m_droppedEvents(0)
+{
+  m_clock.start();
+
+  const QByteArray traceFile = qgetenv("KTUBERLING_TRACE");
+  if (!traceFile.isEmpty())
+  {
+    m_traceFile = QFile::decodeName(traceFile);
+    m_enabled = true;
+  }
+
+  qAddPostRoutine(writeTraceOnExit);
+}
+
+void Instrumentation::setEnabled(bool enabled)
+{
+  if (m_enabled == enabled) return;
+
+  if (!enabled) writeTrace();
+  m_enabled = enabled;
+}
+
+QString Instrumentation::traceFile() const
+{
+  QString fileName = m_traceFile;
+  if (fileName.isEmpty())
+    fileName = QDir::temp().filePath(QStringLiteral("ktuberling-trace-%1.json").arg(QCoreApplication::applicationPid()));
+  if (m_session == 0) return fileName;
+
+  // the first one keeps the name asked for, the next ones get numbered
+  const int dot = fileName.lastIndexOf(QLatin1Char('.'));
+  const int slash = fileName.lastIndexOf(QLatin1Char('/'));
+  const QString suffix = QStringLiteral("-%1").arg(m_session + 1);
+  return dot > slash ? fileName.insert(dot, suffix) : fileName + suffix;
+}
+
+void Instrumentation::setTraceFile(const QString &fileName)
+{
+  m_traceFile = fileName;
+}
+
+qint64 Instrumentation::now() const
+{
+  return m_clock.nsecsElapsed();
+}
+
+void Instrumentation::addDuration(const char *name, qint64 start, qint64 duration)
+{
+  Statistics &statistics = m_durations[QByteArray::fromRawData(name, qstrlen(name))];
+  statistics.calls++;
+  statistics.total += duration;
+  statistics.last = duration;
+  statistics.max = qMax(statistics.max, duration);
+
+  addEvent(name, 'X', start, duration);
+}
+
+void Instrumentation::addEvent(const char *name, char phase, qint64 start, qint64 value)
+{
+  if (m_events.size() >= maxPendingEvents)
+  {
+    m_droppedEvents++;
+    return;
+  }
+  const Event event = { name, phase, start, value };
+  m_events.append(event);
+}
+
+void Instrumentation::count(const char *counter)
+{
+  if (!m_enabled) return;
+
+  const qint64 value = ++m_counters[QByteArray::fromRawData(counter, qstrlen(counter))];
+
+  addEvent(counter, 'C', now(), value);
+}
+
+QString Instrumentation::overlayText() const
+{
+  QStringList lines;
+  QList<QByteArray> names = m_durations.keys();
+  std::sort(names.begin(), names.end());
+  foreach (const QByteArray &name, names)
+  {
+    const Statistics &statistics = m_durations[name];
+    lines << QStringLiteral("%1: %2 ms (avg %3, max %4, %5 calls)")
+               .arg(QString::fromLatin1(name))
+               .arg(statistics.last / 1e6, 0, 'f', 2)
+               .arg(statistics.total / 1e6 / statistics.calls, 0, 'f', 2)
+               .arg(statistics.max / 1e6, 0, 'f', 2)
+               .arg(statistics.calls);
+  }
+
+  names = m_counters.keys();
+  std::sort(names.begin(), names.end());
+  foreach (const QByteArray &name, names)
+  {
+    lines << QStringLiteral("%1: %2").arg(QString::fromLatin1(name)).arg(m_counters[name]);
+  }
+
+  if (m_droppedEvents > 0)
+    lines << QStringLiteral("trace events dropped: %1").arg(m_droppedEvents);
+
+  return lines.join(QLatin1Char('\n'));
+}
+
+// See the "Trace Event Format" document of the Chrome tracing tool
+bool Instrumentation::writeTrace()
+{
+  QFile file(traceFile());
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  file.write("{\"traceEvents\":[\n");
+  for (int i = 0; i < m_events.size(); ++i)
+  {
+    const Event &event = m_events.at(i);
+    QByteArray line = "{\"name\":\"" + QByteArray(event.name) + "\",\"cat\":\"ktuberling\",\"ph\":\"" + event.phase
+                    + "\",\"pid\":" + QByteArray::number(pid) + ",\"tid\":1,\"ts\":" + QByteArray::number(event.start / 1000.0, 'f', 3);
+    if (event.phase == 'X')
+      line += ",\"dur\":" + QByteArray::number(event.value / 1000.0, 'f', 3) + '}';
+    else
+      line += ",\"args\":{\"value\":" + QByteArray::number(event.value) + "}}";
+    if (i + 1 < m_events.size())
+      line += ',';
+    line += '\n';
+    file.write(line);
+  }
+  file.write("],\"displayTimeUnit\":\"ms\"}\n");
+  if (file.error() != QFile::NoError)
+    return false;
+
+  // written, the next session starts from scratch in its own file
+  m_events.clear();
+  m_droppedEvents = 0;
+  m_session++;
+  return true;
+}
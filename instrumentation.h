@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Timing and counting of the expensive parts, for finding out where lag comes from */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Only to be used from the GUI thread.
+// Switched on with KTUBERLING_TRACE=<trace file> or the hidden toggle action.
+class Instrumentation
+{
+  public:
+    static Instrumentation *self();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    // Chrome trace-event JSON, written when disabling and on exit. Every
+    // time it gets enabled again is another session with its own file.
+    QString traceFile() const;
+    void setTraceFile(const QString &fileName);
+    bool writeTrace();
+
+    qint64 now() const;	// nanoseconds since startup
+    void addDuration(const char *name, qint64 start, qint64 duration);
+    void count(const char *counter);
+
+    QString overlayText() const;
+
+    // Times the enclosing block, costs next to nothing when disabled.
+    // A null name times nothing, e.g. for code also run in other threads.
+    class Scope
+    {
+      public:
+        explicit Scope(const char *name)
+         : m_name(name && Instrumentation::self()->isEnabled() ? name : nullptr),
+           m_start(m_name ? Instrumentation::self()->now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+          if (m_name)
+          {
+            Instrumentation *instrumentation = Instrumentation::self();
+            instrumentation->addDuration(m_name, m_start, instrumentation->now() - m_start);
+          }
+        }
+
+      private:
+        const char *m_name;
+        qint64 m_start;
+    };
+
+  private:
+    Instrumentation();
+    void addEvent(const char *name, char phase, qint64 start, qint64 value);
+
+    struct Event
+    {
+      const char *name;
+      char phase;		// 'X' for durations, 'C' for counters
+      qint64 start;
+      qint64 value;		// duration or counter value
+    };
+
+    struct Statistics
+    {
+      Statistics() : calls(0), total(0), last(0), max(0) {}
+      qint64 calls;
+      qint64 total;
+      qint64 last;
+      qint64 max;
+    };
+
+    bool m_enabled;
+    QElapsedTimer m_clock;
+    QString m_traceFile;
+    int m_session;				// how many traces were written
+    QVector<Event> m_events;			// pending trace events, of this session
+    qint64 m_droppedEvents;			// past maxPendingEvents, this session
+    QHash<QByteArray, Statistics> m_durations;	// keys wrap the literal names
+    QHash<QByteArray, qint64> m_counters;
+};
+
+#endif
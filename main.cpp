@@ -16,8 +16,16 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QDBusConnection>
 #include <QDir>
 #include <KDBusService>
+
+#include <stdio.h>
+
+#include "inputrecorder.h"
+#include "performancecounters.h"
+#include "playground.h"
+#include "renderservice.h"
 #include "toplevel.h"
 
 static const char version[] = "1.0.0";
@@ -25,7 +33,9 @@ static const char version[] = "1.0.0";
 // Main function
 int main(int argc, char *argv[])
 {
+  PerformanceCounters::self(); // starts the startup clock
   QApplication app(argc, argv);
+  PerformanceCounters::self()->startupPhase("application");
 
   KLocalizedString::setApplicationDomain("ktuberling");
 
@@ -42,24 +52,91 @@ int main(int argc, char *argv[])
   aboutData.setHomepage(QStringLiteral("http://games.kde.org/ktuberling"));
   QCommandLineParser parser;
   KAboutData::setApplicationData(aboutData);
+  PerformanceCounters::self()->startupPhase("about data");
   KCrash::initialize();
   parser.addOption(QCommandLineOption(QStringList() <<  QStringLiteral("+<tuberling-file>"), i18n("Potato to open")));
+  QCommandLineOption stressOption(QStringLiteral("stress"), i18n("Fill the gameboard with <count> random objects"), i18n("count"));
+  parser.addOption(stressOption);
+  QCommandLineOption recordOption(QStringLiteral("record"), i18n("Record the mouse input to <file>"), i18n("file"));
+  parser.addOption(recordOption);
+  QCommandLineOption replayOption(QStringLiteral("replay"), i18n("Replay the mouse input recorded in <file>, report the latencies and quit"), i18n("file"));
+  parser.addOption(replayOption);
+  QCommandLineOption replayFastOption(QStringLiteral("replay-fast"), i18n("Replay as fast as possible instead of at the recorded pace"));
+  parser.addOption(replayFastOption);
+  QCommandLineOption profileStartupOption(QStringLiteral("profile-startup"), i18n("Write where startup time goes to <file> as JSON and quit once the board is shown"), i18n("file"));
+  parser.addOption(profileStartupOption);
+  QCommandLineOption renderServiceOption(QStringLiteral("render-service"), i18n("Render the saved tuberlings sent to the local socket <name> as PNG pictures, without any window"), i18n("name"));
+  parser.addOption(renderServiceOption);
 
   aboutData.setupCommandLine(&parser);
   parser.process(app);
   aboutData.processCommandLine(&parser);
+  PerformanceCounters::self()->startupPhase("command line");
+
+  if (parser.isSet(renderServiceOption))
+  {
+      // Works headless too, with -platform offscreen
+      RenderService renderService;
+      if (!renderService.listen(parser.value(renderServiceOption)))
+      {
+          fprintf(stderr, "%s\n", qPrintable(i18n("Could not listen on %1: %2", parser.value(renderServiceOption), renderService.errorString())));
+          return 1;
+      }
+      return app.exec();
+  }
+
+  if (parser.isSet(profileStartupOption))
+  {
+      const QString reportFile = parser.value(profileStartupOption);
+      // queued, the first frame is still being painted when startup finishes
+      QObject::connect(PerformanceCounters::self(), &PerformanceCounters::startupFinished, &app, [reportFile]
+      {
+          if (!PerformanceCounters::self()->writeStartupReport(reportFile))
+              fprintf(stderr, "%s\n", qPrintable(i18n("Could not write the startup profile to %1", reportFile)));
+          qApp->quit();
+      }, Qt::QueuedConnection);
+  }
 
   KDBusService service;
+  // qdbus org.kde.ktuberling /PerformanceCounters counters
+  QDBusConnection::sessionBus().registerObject(QStringLiteral("/PerformanceCounters"), PerformanceCounters::self(), QDBusConnection::ExportScriptableSlots);
+  PerformanceCounters::self()->startupPhase("dbus");
   TopLevel *toplevel=0;
 
   if (app.isSessionRestored())
       RESTORE(TopLevel)
   else {
       toplevel = new TopLevel();
+      PerformanceCounters::self()->startupPhase("main window");
       toplevel->show();
+      PerformanceCounters::self()->startupPhase("show");
       if (parser.positionalArguments().count())
           toplevel->open(QUrl::fromUserInput(parser.positionalArguments().at(0), QDir::currentPath()));
 
+      if (parser.isSet(stressOption))
+          toplevel->currentPlayGround()->fillWithRandomItems(parser.value(stressOption).toInt());
+
+      if (parser.isSet(replayOption))
+      {
+          // Works headless too, with -platform offscreen
+          InputReplayer *replayer = new InputReplayer(toplevel->currentPlayGround(), toplevel);
+          if (!replayer->load(parser.value(replayOption)))
+          {
+              fprintf(stderr, "%s\n", qPrintable(i18n("Could not read the input recording %1", parser.value(replayOption))));
+              return 1;
+          }
+          QObject::connect(replayer, &InputReplayer::finished, &app, [replayer]
+          {
+              fprintf(stdout, "%s\n", qPrintable(replayer->report()));
+              qApp->quit();
+          });
+          replayer->start(parser.isSet(replayFastOption));
+      }
+      else if (parser.isSet(recordOption))
+      {
+          if (!toplevel->currentPlayGround()->startRecording(parser.value(recordOption)))
+              fprintf(stderr, "%s\n", qPrintable(i18n("Could not record the input to %1", parser.value(recordOption))));
+      }
   }
 
   app.setWindowIcon(QIcon::fromTheme(QStringLiteral("ktuberling")));
@@ -8,37 +8,129 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <QAbstractListModel>
 #include <QApplication>
 #include <QDebug>
 #include <QDesktopWidget>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QListView>
 #include <QPushButton>
 
 #include "filefactory.h"
+#include "performancecounters.h"
 #include "soundfactory.h"
 #include "playground.h"
+#include "thumbnailcache.h"
 
 static const char version[] = "1.0.0";
 
+// The themes to choose from, thumbnails are only asked for when a view shows them
+class ThemeListModel : public QAbstractListModel
+{
+public:
+  ThemeListModel(ThumbnailCache *thumbnails, const QSize &thumbnailSize, qreal devicePixelRatio)
+   : m_thumbnails(thumbnails), m_thumbnailSize(thumbnailSize), m_devicePixelRatio(devicePixelRatio)
+  {
+    QObject::connect(thumbnails, &ThumbnailCache::thumbnailReady, this, [this](const QString &gameboardFile) {
+      for (int row = 0; row < m_themes.count(); ++row)
+      {
+        if (m_themes.at(row).gameboardFile == gameboardFile)
+          emit dataChanged(index(row), index(row), QVector<int>() << Qt::DecorationRole);
+      }
+    });
+  }
+
+  void addTheme(const QString &name, const QString &boardFile, const QString &gameboardFile)
+  {
+    // the theme changed on disk
+    const int row = findTheme(boardFile);
+    if (row != -1)
+    {
+      m_themes[row].name = name;
+      m_themes[row].gameboardFile = gameboardFile;
+      m_thumbnails->invalidate(gameboardFile);
+      emit dataChanged(index(row), index(row));
+      return;
+    }
+
+    beginInsertRows(QModelIndex(), m_themes.count(), m_themes.count());
+    const Theme theme = { name, boardFile, gameboardFile };
+    m_themes << theme;
+    endInsertRows();
+  }
+
+  void removeTheme(const QString &boardFile)
+  {
+    const int row = findTheme(boardFile);
+    if (row == -1) return;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_themes.removeAt(row);
+    endRemoveRows();
+  }
+
+  int findTheme(const QString &boardFile) const
+  {
+    for (int row = 0; row < m_themes.count(); ++row)
+    {
+      if (m_themes.at(row).boardFile == boardFile)
+        return row;
+    }
+    return -1;
+  }
+
+  QString boardFile(const QModelIndex &index) const
+  {
+    return m_themes.at(index.row()).boardFile;
+  }
+
+  int rowCount(const QModelIndex &parent) const override
+  {
+    return parent.isValid() ? 0 : m_themes.count();
+  }
+
+  QVariant data(const QModelIndex &index, int role) const override
+  {
+    if (!index.isValid()) return QVariant();
+
+    const Theme &theme = m_themes.at(index.row());
+    if (role == Qt::DisplayRole) return theme.name;
+    if (role == Qt::DecorationRole)
+    {
+      const QPixmap thumbnail = m_thumbnails->thumbnail(theme.gameboardFile, m_thumbnailSize, m_devicePixelRatio);
+      if (!thumbnail.isNull()) return thumbnail;
+    }
+    return QVariant();
+  }
+
+private:
+  struct Theme
+  {
+    QString name;
+    QString boardFile;
+    QString gameboardFile;
+  };
+
+  ThumbnailCache *m_thumbnails;
+  QSize m_thumbnailSize;
+  qreal m_devicePixelRatio;
+  QVector<Theme> m_themes;
+};
+
 class KTuberlingMobile : public PlayGroundCallbacks, public SoundFactoryCallbacks
 {
 public:
   KTuberlingMobile()
    : m_soundEnabled(true)
   {
+    // Only what the default board needs comes before showing it
     m_soundFactory = new SoundFactory(this);
-    m_soundFactory->registerLanguages();
-    m_soundFactory->loadLanguage(FileFactory::locate("sounds/en.soundtheme"));
 
     QWidget *mainWidget = new QWidget();
     QHBoxLayout *lay = new QHBoxLayout(mainWidget);
 
-    m_themesWidget = new QWidget();
-    m_gameboardLayout = new QGridLayout(m_themesWidget);
-
     m_playground = new PlayGround(this, mainWidget);
-    m_playground->registerPlayGrounds();
     m_playground->lockAspectRatio(true);
     m_playground->setAllowOnlyDrag(true);
     m_playground->loadPlayGround(FileFactory::locate("pics/default_theme.theme"));
@@ -49,12 +141,31 @@ public:
     const int screenWidth = QDesktopWidget().screenGeometry().width();
     const int iconWidth = screenWidth / 15;
 
+    // A grid only rendering the thumbnails it shows
+    const QSize thumbnailSize(screenWidth / 4, screenWidth / 8);
+    m_thumbnails = new ThumbnailCache();
+    m_themes = new ThemeListModel(m_thumbnails, thumbnailSize, qApp->devicePixelRatio());
+    m_themesView = new QListView();
+    m_themesView->setViewMode(QListView::IconMode);
+    m_themesView->setUniformItemSizes(true);
+    m_themesView->setLayoutMode(QListView::Batched);
+    m_themesView->setResizeMode(QListView::Adjust);
+    m_themesView->setMovement(QListView::Static);
+    m_themesView->setWordWrap(true);
+    m_themesView->setIconSize(thumbnailSize);
+    m_themesView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    m_themesView->setModel(m_themes);
+    QObject::connect(m_themesView, &QListView::clicked, [this](const QModelIndex &index) {
+      m_playground->switchPlayGround(m_themes->boardFile(index));
+      m_themesView->hide();
+    });
+
     QPushButton *themesButton = new QPushButton(mainWidget);
     themesButton->setIcon(QPixmap(":/games-config-theme.png"));
     themesButton->setIconSize(QSize(iconWidth, iconWidth));
     themesButton->setFocusPolicy(Qt::NoFocus);
     QObject::connect(themesButton, &QPushButton::clicked, [this, mainWidget] {
-      m_themesWidget->showFullScreen();
+      m_themesView->showFullScreen();
     });
 
     QPushButton *soundsButton = new QPushButton(mainWidget);
@@ -76,34 +187,36 @@ public:
     lay->addLayout(sideLayout);
 
     mainWidget->showFullScreen();
+
+    // The rest once the board is on screen
+    QObject::connect(PerformanceCounters::self(), &PerformanceCounters::startupFinished, m_themesView, [this] {
+      m_soundFactory->registerLanguages();
+      m_soundFactory->loadLanguage(FileFactory::locate("sounds/en.soundtheme"));
+      m_playground->registerPlayGrounds();
+    }, Qt::QueuedConnection);
   }
 
   ~KTuberlingMobile()
   {
+    delete m_themesView;
+    delete m_themes;
+    delete m_thumbnails;
     delete m_soundFactory;
   }
 
-  void playSound(const QString &ref) override
+  void playSound(Gameboard *gameboard, int sound) override
   {
-    m_soundFactory->playSound(ref);
+    m_soundFactory->playSound(gameboard, sound);
   }
 
-  void changeGameboard(const QString &/*gameboard*/) override
+  void registerGameboard(const QString& menuText, const QString& boardFile, const QString &gameboardFile) override
   {
-    // Only needed when loading a file so not needed for now
+    m_themes->addTheme(menuText, boardFile, gameboardFile);
   }
 
-  void registerGameboard(const QString& menuText, const QString& boardFile, const QPixmap &/*pixmap*/) override
+  void unregisterGameboard(const QString& boardFile) override
   {
-    // TODO this should be scrollable
-    // TODO use the pixmap
-    QPushButton *pb = new QPushButton(menuText);
-    QObject::connect(pb, &QPushButton::clicked, [this, boardFile] {
-      m_playground->loadPlayGround(boardFile);
-      m_themesWidget->hide();
-    });
-
-    m_gameboardLayout->addWidget(pb, m_gameboardLayout->count() / 2, m_gameboardLayout->count() % 2);
+    m_themes->removeTheme(boardFile);
   }
 
   bool isSoundEnabled() const override
@@ -119,8 +232,9 @@ public:
 private:
   SoundFactory *m_soundFactory;
   PlayGround *m_playground;
-  QWidget *m_themesWidget;
-  QGridLayout *m_gameboardLayout;
+  ThumbnailCache *m_thumbnails;
+  ThemeListModel *m_themes;
+  QListView *m_themesView;
   bool m_soundEnabled;
 };
 
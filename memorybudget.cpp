@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* One memory budget for all the caches of the process */
+
+#include "memorybudget.h"
+
+#include <algorithm>
+
+#include <kconfiggroup.h>
+#include <ksharedconfig.h>
+
+#if defined(Q_OS_ANDROID)
+#include <QGuiApplication>
+#endif
+
+#include "instrumentation.h"
+
+// Phones have far less to spare
+#if defined(Q_OS_ANDROID)
+static const int defaultCapMegabytes = 64;
+#else
+static const int defaultCapMegabytes = 256;
+#endif
+
+MemoryBudget *MemoryBudget::self()
+{
+  static MemoryBudget instance;
+  return &instance;
+}
+
+MemoryBudget::MemoryBudget()
+ : m_evicting(false)
+{
+  KConfigGroup config(KSharedConfig::openConfig(), "MemoryBudget");
+  m_cap = qint64(config.readEntry("Cap", defaultCapMegabytes)) * 1024 * 1024;
+
+#if defined(Q_OS_ANDROID)
+  // Android does not tell about memory pressure through Qt, but apps
+  // sent to the background are the first ones it kills. Elsewhere a
+  // minimized window is no reason to render everything again.
+  if (QGuiApplication *application = qobject_cast<QGuiApplication *>(QCoreApplication::instance()))
+  {
+    connect(application, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state)
+    {
+      if (state == Qt::ApplicationSuspended || state == Qt::ApplicationHidden)
+        lowMemory();
+    });
+  }
+#endif
+}
+
+void MemoryBudget::registerCache(const char *name, Cost cost, Cache *cache)
+{
+  const Entry entry = { name, cost, cache };
+  QVector<Entry>::iterator it = m_caches.begin();
+  while (it != m_caches.end() && it->cost <= cost) ++it;
+  m_caches.insert(it, entry);
+}
+
+void MemoryBudget::unregisterCache(Cache *cache)
+{
+  for (int i = 0; i < m_caches.count(); ++i)
+  {
+    if (m_caches.at(i).cache == cache)
+    {
+      m_caches.remove(i);
+      return;
+    }
+  }
+}
+
+qint64 MemoryBudget::cap() const
+{
+  return m_cap;
+}
+
+void MemoryBudget::setCap(qint64 bytes)
+{
+  m_cap = bytes;
+  checkBudget();
+}
+
+qint64 MemoryBudget::memoryUsed() const
+{
+  qint64 used = 0;
+  for (const Entry &entry : m_caches)
+    used += entry.cache->memoryUsed();
+  return used;
+}
+
+void MemoryBudget::checkBudget()
+{
+  if (m_evicting) return;
+
+  if (memoryUsed() > m_cap)
+    evictDownTo(m_cap);
+}
+
+void MemoryBudget::lowMemory()
+{
+  if (m_evicting) return;
+
+  evictDownTo(0);
+}
+
+void MemoryBudget::evictDownTo(qint64 bytes)
+{
+  Instrumentation::Scope scope("MemoryBudget::evict");
+
+  // Evicting may unregister caches, e.g. a dropped scene releases its
+  // gameboard, so this goes through a copy of the list and skips the ones
+  // gone meanwhile. What cannot be evicted still counts, the others give
+  // back all the more.
+  m_evicting = true;
+  qint64 excess = memoryUsed() - bytes;
+  const QVector<Entry> caches = m_caches;
+  for (const Entry &entry : caches)
+  {
+    if (excess <= 0) break;
+    const bool registered = std::any_of(m_caches.constBegin(), m_caches.constEnd(),
+                                        [&entry](const Entry &other) { return other.cache == entry.cache; });
+    if (registered)
+      excess -= entry.cache->evict(excess);
+  }
+  m_evicting = false;
+}
+
+QVariantMap MemoryBudget::usage() const
+{
+  QVariantMap used, evictable;
+  qint64 total = 0, evictableTotal = 0;
+  for (const Entry &entry : m_caches)
+  {
+    const QString name = QLatin1String(entry.name);
+    const qint64 cacheUsed = entry.cache->memoryUsed();
+    const qint64 cacheEvictable = entry.cache->memoryEvictable();
+    used.insert(name, used.value(name).toLongLong() + cacheUsed);
+    evictable.insert(name, evictable.value(name).toLongLong() + cacheEvictable);
+    total += cacheUsed;
+    evictableTotal += cacheEvictable;
+  }
+
+  QVariantMap usage;
+  usage.insert(QStringLiteral("used"), used);
+  usage.insert(QStringLiteral("evictable"), evictable);
+  usage.insert(QStringLiteral("total"), total);
+  usage.insert(QStringLiteral("evictableTotal"), evictableTotal);
+  usage.insert(QStringLiteral("cap"), m_cap);
+  return usage;
+}
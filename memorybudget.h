@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* One memory budget for all the caches of the process */
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QVector>
+
+// The caches register here instead of each having its own limit. Once
+// they take more than the cap in all, set by Cap (in megabytes) in the
+// MemoryBudget group of the configuration, the cheapest to regenerate
+// give back what they can do without first. Only to be used from the
+// GUI thread.
+class MemoryBudget : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // Something holding memory, some of which it can do without
+    class Cache
+    {
+      public:
+        virtual ~Cache() {}
+        // All it holds, what counts against the cap
+        virtual qint64 memoryUsed() const = 0;
+        // What evict() could give back, all of it unless told otherwise
+        virtual qint64 memoryEvictable() const { return memoryUsed(); }
+        // Give back at least bytes if possible, returns what was given back
+        virtual qint64 evict(qint64 bytes) = 0;
+    };
+
+    // What it takes to get evicted memory back, cheapest first
+    enum Cost { ReadFromDisk, RenderElement, RenderGameboard, LoadTheme };
+
+    static MemoryBudget *self();
+
+    void registerCache(const char *name, Cost cost, Cache *cache);
+    void unregisterCache(Cache *cache);
+
+    qint64 cap() const;
+    void setCap(qint64 bytes);
+
+    // To be called when a cache grew, it may be asked to evict right away
+    void checkBudget();
+
+    // "used" and "evictable", each cache name -> bytes, their totals
+    // "total" and "evictableTotal", and the cap
+    QVariantMap usage() const;
+
+  public Q_SLOTS:
+    // Give back everything that can be given back
+    void lowMemory();
+
+  private:
+    MemoryBudget();
+    qint64 memoryUsed() const;
+    void evictDownTo(qint64 bytes);
+
+    struct Entry
+    {
+      const char *name;
+      Cost cost;
+      Cache *cache;
+    };
+    QVector<Entry> m_caches;		// by cost
+    qint64 m_cap;
+    bool m_evicting;
+};
+
+#endif
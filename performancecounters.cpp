@@ -0,0 +1,223 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Always on performance counters, sampled over D-Bus */
+
+#include "performancecounters.h"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "instrumentation.h"
+#include "memorybudget.h"
+#include "playground.h"
+
+// How many of the last frames are kept
+static const int frameHistory = 120;
+
+static const char *cacheNames[] = { "elementPixmaps", "backgroundLevels", "scenes" };
+// Also counted in the trace, those want names that live forever
+static const char *cacheHitNames[] = { "element pixmap cache hits", "background level cache hits", "scene cache hits" };
+static const char *cacheMissNames[] = { "element pixmap cache misses", "background level cache misses", "scene cache misses" };
+
+PerformanceCounters *PerformanceCounters::self()
+{
+  static PerformanceCounters instance;
+  return &instance;
+}
+
+PerformanceCounters::PerformanceCounters()
+ : m_lastPhase(0), m_startupFinished(false), m_nextFrame(0),
+   m_sounds(0), m_lastSoundLatency(0), m_totalSoundLatency(0), m_maxSoundLatency(0)
+{
+  m_startupClock.start();
+  for (int cache = 0; cache < CacheCount; ++cache)
+  {
+    m_cacheHits[cache] = 0;
+    m_cacheMisses[cache] = 0;
+  }
+  m_frameTimes.reserve(frameHistory);
+}
+
+void PerformanceCounters::startupPhase(const char *name)
+{
+  if (m_startupFinished) return;
+
+  const qint64 now = m_startupClock.nsecsElapsed();
+  m_startupPhases << qMakePair(QString::fromLatin1(name), now - m_lastPhase);
+  m_lastPhase = now;
+}
+
+bool PerformanceCounters::isStartupFinished() const
+{
+  return m_startupFinished;
+}
+
+void PerformanceCounters::addThemeTiming(const QString &theme, qint64 parseNsecs, qint64 configNsecs)
+{
+  if (m_startupFinished) return;
+
+  const ThemeTiming timing = { theme, parseNsecs, configNsecs };
+  m_themeTimings << timing;
+}
+
+bool PerformanceCounters::writeStartupReport(const QString &fileName) const
+{
+  QJsonArray phases;
+  qint64 total = 0;
+  for (const QPair<QString, qint64> &phase : m_startupPhases)
+  {
+    QJsonObject object;
+    object.insert(QStringLiteral("name"), phase.first);
+    object.insert(QStringLiteral("ms"), phase.second / 1e6);
+    phases.append(object);
+    total += phase.second;
+  }
+
+  QVector<ThemeTiming> timings = m_themeTimings;
+  std::sort(timings.begin(), timings.end(), [](const ThemeTiming &a, const ThemeTiming &b)
+  {
+    return a.parse + a.config > b.parse + b.config;
+  });
+  QJsonArray themes;
+  for (const ThemeTiming &timing : timings)
+  {
+    QJsonObject object;
+    object.insert(QStringLiteral("theme"), timing.theme);
+    object.insert(QStringLiteral("parseMs"), timing.parse / 1e6);
+    object.insert(QStringLiteral("configMs"), timing.config / 1e6);
+    object.insert(QStringLiteral("totalMs"), (timing.parse + timing.config) / 1e6);
+    themes.append(object);
+  }
+
+  QJsonObject report;
+  report.insert(QStringLiteral("phases"), phases);
+  report.insert(QStringLiteral("totalMs"), total / 1e6);
+  report.insert(QStringLiteral("themes"), themes);
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(QJsonDocument(report).toJson());
+  return file.error() == QFile::NoError;
+}
+
+void PerformanceCounters::cacheHit(Cache cache)
+{
+  m_cacheHits[cache]++;
+  Instrumentation::self()->count(cacheHitNames[cache]);
+}
+
+void PerformanceCounters::cacheMiss(Cache cache)
+{
+  m_cacheMisses[cache]++;
+  Instrumentation::self()->count(cacheMissNames[cache]);
+}
+
+void PerformanceCounters::addFrameTime(qint64 nsecs)
+{
+  if (!m_startupFinished)
+  {
+    startupPhase("first paint");
+    m_startupFinished = true;
+    emit startupFinished();
+  }
+
+  if (m_frameTimes.count() < frameHistory) m_frameTimes << nsecs;
+  else m_frameTimes[m_nextFrame] = nsecs;
+  m_nextFrame = (m_nextFrame + 1) % frameHistory;
+}
+
+void PerformanceCounters::addSoundStartLatency(qint64 msecs)
+{
+  m_sounds++;
+  m_lastSoundLatency = msecs;
+  m_totalSoundLatency += msecs;
+  m_maxSoundLatency = qMax(m_maxSoundLatency, msecs);
+}
+
+void PerformanceCounters::setPlayGround(PlayGround *playGround)
+{
+  m_playGround = playGround;
+}
+
+QVariantMap PerformanceCounters::startupPhases() const
+{
+  QVariantMap phases;
+  qint64 total = 0;
+  for (const QPair<QString, qint64> &phase : m_startupPhases)
+  {
+    phases.insert(phase.first, phase.second / 1e6);
+    total += phase.second;
+  }
+  phases.insert(QStringLiteral("total"), total / 1e6);
+  return phases;
+}
+
+QVariantMap PerformanceCounters::caches() const
+{
+  QVariantMap caches;
+  for (int cache = 0; cache < CacheCount; ++cache)
+  {
+    const qint64 lookups = m_cacheHits[cache] + m_cacheMisses[cache];
+    QVariantMap counters;
+    counters.insert(QStringLiteral("hits"), m_cacheHits[cache]);
+    counters.insert(QStringLiteral("misses"), m_cacheMisses[cache]);
+    counters.insert(QStringLiteral("hitRate"), lookups ? double(m_cacheHits[cache]) / lookups : 0.0);
+    caches.insert(QLatin1String(cacheNames[cache]), counters);
+  }
+  return caches;
+}
+
+QVariantMap PerformanceCounters::scene() const
+{
+  if (!m_playGround) return QVariantMap();
+  return m_playGround->sceneStatistics();
+}
+
+QVariantList PerformanceCounters::frameTimes() const
+{
+  QVariantList frameTimes;
+  // once the ring is full the oldest frame is the next one to be overwritten
+  const int first = m_frameTimes.count() < frameHistory ? 0 : m_nextFrame;
+  for (int i = 0; i < m_frameTimes.count(); ++i)
+    frameTimes << m_frameTimes.at((first + i) % m_frameTimes.count()) / 1e6;
+  return frameTimes;
+}
+
+QVariantMap PerformanceCounters::soundStartLatency() const
+{
+  QVariantMap latency;
+  latency.insert(QStringLiteral("count"), m_sounds);
+  latency.insert(QStringLiteral("lastMs"), m_lastSoundLatency);
+  latency.insert(QStringLiteral("meanMs"), m_sounds ? double(m_totalSoundLatency) / m_sounds : 0.0);
+  latency.insert(QStringLiteral("maxMs"), m_maxSoundLatency);
+  return latency;
+}
+
+QVariantMap PerformanceCounters::memory() const
+{
+  return MemoryBudget::self()->usage();
+}
+
+QVariantMap PerformanceCounters::counters() const
+{
+  QVariantMap counters;
+  counters.insert(QStringLiteral("startupPhases"), startupPhases());
+  counters.insert(QStringLiteral("caches"), caches());
+  counters.insert(QStringLiteral("scene"), scene());
+  counters.insert(QStringLiteral("frameTimes"), frameTimes());
+  counters.insert(QStringLiteral("soundStartLatency"), soundStartLatency());
+  counters.insert(QStringLiteral("memory"), memory());
+  return counters;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Always on performance counters, sampled over D-Bus */
+
+#ifndef PERFORMANCECOUNTERS_H
+#define PERFORMANCECOUNTERS_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QVariantMap>
+#include <QVector>
+
+class PlayGround;
+
+// Unlike Instrumentation these are cheap enough to always be collected.
+// Only to be used from the GUI thread.
+class PerformanceCounters : public QObject
+{
+  Q_OBJECT
+  Q_CLASSINFO("D-Bus Interface", "org.kde.ktuberling.PerformanceCounters")
+
+  public:
+    enum Cache { ElementPixmapCache, BackgroundLevelCache, SceneCache, CacheCount };
+
+    static PerformanceCounters *self();
+
+    // Time since the previous phase, until the first frame is painted
+    void startupPhase(const char *name);
+    bool isStartupFinished() const;
+    // What registering each theme cost during startup
+    void addThemeTiming(const QString &theme, qint64 parseNsecs, qint64 configNsecs);
+    // JSON with the phases in order and the themes, most expensive first
+    bool writeStartupReport(const QString &fileName) const;
+
+    void cacheHit(Cache cache);
+    void cacheMiss(Cache cache);
+    void addFrameTime(qint64 nsecs);
+    void addSoundStartLatency(qint64 msecs);
+
+    void setPlayGround(PlayGround *playGround);
+
+  Q_SIGNALS:
+    void startupFinished();
+
+  public Q_SLOTS:
+    // phase name -> milliseconds
+    Q_SCRIPTABLE QVariantMap startupPhases() const;
+    // cache name -> { hits, misses, hitRate }
+    Q_SCRIPTABLE QVariantMap caches() const;
+    // gameboard, items, cachedScenes, totalItems, undoCommands, undoBytes
+    Q_SCRIPTABLE QVariantMap scene() const;
+    // milliseconds, oldest first
+    Q_SCRIPTABLE QVariantList frameTimes() const;
+    // count, lastMs, meanMs, maxMs
+    Q_SCRIPTABLE QVariantMap soundStartLatency() const;
+    // cache name -> bytes that could be given back, and the cap
+    Q_SCRIPTABLE QVariantMap memory() const;
+    // all of the above in one go
+    Q_SCRIPTABLE QVariantMap counters() const;
+
+  private:
+    PerformanceCounters();
+
+    struct ThemeTiming
+    {
+      QString theme;
+      qint64 parse, config;		// nanoseconds
+    };
+
+    QElapsedTimer m_startupClock;
+    qint64 m_lastPhase;
+    bool m_startupFinished;
+    QVector<QPair<QString, qint64> > m_startupPhases;	// nanoseconds
+    QVector<ThemeTiming> m_themeTimings;
+
+    qint64 m_cacheHits[CacheCount];
+    qint64 m_cacheMisses[CacheCount];
+
+    QVector<qint64> m_frameTimes;		// ring buffer
+    int m_nextFrame;
+
+    int m_sounds;
+    qint64 m_lastSoundLatency, m_totalSoundLatency, m_maxSoundLatency;
+
+    QPointer<PlayGround> m_playGround;
+};
+
+#endif
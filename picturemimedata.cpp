@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Clipboard data that encodes the picture only when asked for */
+
+#include "picturemimedata.h"
+
+#include <QBuffer>
+#include <QImageWriter>
+#include <QMimeDatabase>
+
+static const char *qtImageMimeType = "application/x-qt-image";
+
+PictureMimeData::PictureMimeData(const QImage &image)
+ : m_image(image)
+{
+  // The raw image first, so that in-process pastes never encode anything
+  m_formats << QLatin1String(qtImageMimeType);
+
+  const QList<QByteArray> writerMimeTypes = QImageWriter::supportedMimeTypes();
+  for (const QByteArray &mimeType : writerMimeTypes)
+  {
+    const QString format = QString::fromLatin1(mimeType);
+    // Favor png
+    if (format == QLatin1String("image/png")) m_formats.insert(1, format);
+    else m_formats << format;
+  }
+}
+
+bool PictureMimeData::hasFormat(const QString &mimeType) const
+{
+  return m_formats.contains(mimeType);
+}
+
+QStringList PictureMimeData::formats() const
+{
+  return m_formats;
+}
+
+QVariant PictureMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+  if (mimeType == QLatin1String(qtImageMimeType))
+    return m_image;
+
+  if (!m_formats.contains(mimeType))
+    return QMimeData::retrieveData(mimeType, type);
+
+  QHash<QString, QByteArray>::const_iterator it = m_encoded.constFind(mimeType);
+  if (it != m_encoded.constEnd())
+    return it.value();
+
+  const QMimeType mime = QMimeDatabase().mimeTypeForName(mimeType);
+  if (!mime.isValid() || mime.preferredSuffix().isEmpty())
+    return QVariant();
+
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  QImageWriter writer(&buffer, mime.preferredSuffix().toLatin1());
+  if (!writer.write(m_image))
+    return QVariant();
+
+  m_encoded.insert(mimeType, data);
+  return data;
+}
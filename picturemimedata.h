@@ -0,0 +1,38 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Clipboard data that encodes the picture only when asked for */
+
+#ifndef PICTUREMIMEDATA_H
+#define PICTUREMIMEDATA_H
+
+#include <QHash>
+#include <QImage>
+#include <QMimeData>
+
+class PictureMimeData : public QMimeData
+{
+  Q_OBJECT
+
+  public:
+    explicit PictureMimeData(const QImage &image);
+
+    bool hasFormat(const QString &mimeType) const override;
+    QStringList formats() const override;
+
+  protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+
+  private:
+    QImage m_image;
+    QStringList m_formats;
+    mutable QHash<QString, QByteArray> m_encoded;	// formats already requested by someone
+};
+
+#endif
@@ -12,55 +12,108 @@
 
 #include "playground.h"
 
-#include <kconfig.h>
-#include <kconfiggroup.h>
-#include <qdebug.h>
-
 #include <QAction>
 #include <QApplication>
 #include <QCursor>
 #include <QDataStream>
-#include <QDir>
-#include <QDomDocument>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
-#include <QGraphicsSvgItem>
+#include <QFutureWatcher>
+#include <QGestureEvent>
+#include <QGuiApplication>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPagedPaintDevice>
+#include <QScreen>
+#include <QScrollBar>
+#include <QSet>
+#include <QWheelEvent>
+#include <QWindow>
+#include <QtMath>
+
+#include <algorithm>
+#include <random>
 
 #include "action.h"
+#include "backgrounditem.h"
 #include "filefactory.h"
+#include "gameboard.h"
+#include "gameboardrepository.h"
+#include "inputrecorder.h"
+#include "instrumentation.h"
+#include "performancecounters.h"
+#include "savegame.h"
+#include "timelapse.h"
 #include "todraw.h"
 
-static const char *saveGameTextScaleTextMode = "KTuberlingSaveGameV2";
-static const char *saveGameTextTextMode = "KTuberlingSaveGameV3";
-static const char *saveGameText = "KTuberlingSaveGameV4";
+// How sparse Z values may get before being renormalized
+static const int zCompactionSlack = 1024;
+
+// How long the size must not change before rendering at the new one (ms)
+static const int resizeSettleDelay = 150;
+
+// How far the board can be zoomed in
+static const qreal maxZoom = 8;
+
+// What a scene takes besides its objects and their undo commands: the
+// scene, its index and the background item. The pictures of the gameboard
+// count in the gameboard.
+static const qint64 emptySceneBytes = 16 * 1024;
+
+// What Qt keeps for an object besides the ToDraw itself, its private data
+// and its entry in the index, see playgroundbenchmark memoryPerItem
+static const qint64 itemOverheadBytes = 320;
+
 
 // Constructor
 PlayGround::PlayGround(PlayGroundCallbacks *callbacks, QWidget *parent)
-    : QGraphicsView(parent), m_callbacks(callbacks), m_newItem(0), m_dragItem(0), m_nextZValue(1), m_lockAspect(false), m_allowOnlyDrag(false)
+    : QGraphicsView(parent), m_callbacks(callbacks), m_newItem(0), m_dragItem(0), m_coalesceMoves(qgetenv("KTUBERLING_COALESCE_MOVES") != "0"), m_pendingMoveTime(-1), m_dragFrameStart(-1), m_gameboard(nullptr), m_switchGeneration(0), m_zoom(1), m_panning(false), m_lockAspect(false), m_allowOnlyDrag(false), m_recorder(nullptr)
 {
   setFrameStyle(QFrame::NoFrame);
   setOptimizationFlag(QGraphicsView::DontSavePainterState, true); // all items here save the painter state
   setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
   setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-  setMouseTracking(true);
+
+  m_moveTimer.setSingleShot(true);
+  connect(&m_moveTimer, &QTimer::timeout, this, &PlayGround::flushPendingMove);
+
+  m_resizeTimer.setSingleShot(true);
+  m_resizeTimer.setInterval(resizeSettleDelay);
+  connect(&m_resizeTimer, &QTimer::timeout, this, &PlayGround::finishResize);
+
+  viewport()->setAttribute(Qt::WA_AcceptTouchEvents);
+  viewport()->grabGesture(Qt::PinchGesture);
+  // KTUBERLING_TRACE turns it on from the start
+  setInstrumentationShown(Instrumentation::self()->isEnabled());
+
+  connect(GameboardRepository::self(), &GameboardRepository::gameboardChanged, this, &PlayGround::gameboardChanged);
+
+  MemoryBudget::self()->registerCache("scenes", MemoryBudget::LoadTheme, this);
 }
 
 // Destructor
 PlayGround::~PlayGround()
 {
+  MemoryBudget::self()->unregisterCache(this);
+
+  delete m_recorder;
+  // in no scene while picked up
+  delete m_newItem;
+  delete m_dragItem;
+
   foreach (const SceneData &data, m_scenes)
   {
     delete data.scene;
     delete data.undoStack;
   }
+  deleteEvictedScenes();
 }
 
 // Reset the play ground
 void PlayGround::reset()
 {
+  cancelPickedItem();
 
   foreach(QGraphicsItem *item, scene()->items())
   {
@@ -69,6 +122,10 @@ void PlayGround::reset()
   }
 
   undoStack()->clear();
+
+  SceneData &data = m_scenes[m_gameboardFile];
+  data.nextZValue = 1;
+  data.zCompactionLimit = zCompactionSlack;
 }
 
 // Save objects laid down on the editable area
@@ -78,18 +135,26 @@ bool PlayGround::saveAs(const QString & name)
   if (!f.open( QIODevice::WriteOnly ) )
       return false;
 
+  return saveAs(&f) && (f.error() == QFile::NoError);
+}
+
+// Save objects laid down on the editable area to an already opened device
+bool PlayGround::saveAs(QIODevice *device)
+{
   QFileInfo gameBoard(m_gameboardFile);
-  QDataStream out(&f);
+  QDataStream out(device);
   out.setVersion(QDataStream::Qt_4_5);
   out << QString::fromLatin1(saveGameText);
   out << gameBoard.fileName();
+  const QPointF heldPos = putPickedItemInScene();
   foreach(QGraphicsItem *item, scene()->items())
   {
     ToDraw *currentObject = qgraphicsitem_cast<ToDraw *>(item);
     if (currentObject != NULL) currentObject->save(out);
   }
+  takePickedItemFromScene(heldPos);
 
-  return (f.error() == QFile::NoError);
+  return (out.status() == QDataStream::Ok);
 }
 
 // Print gameboard's picture
@@ -109,27 +174,109 @@ QPixmap PlayGround::getPicture()
 {
   QPixmap result(mapFromScene(backgroundRect()).boundingRect().size());
   QPainter artist(&result);
+  const QPointF heldPos = putPickedItemInScene();
+  scene()->render(&artist, QRectF(), backgroundRect(), Qt::IgnoreAspectRatio);
+  takePickedItemFromScene(heldPos);
+  artist.end();
+  return result;
+}
+
+// Get an image containing the current picture, safe to hand over to other threads
+QImage PlayGround::getImage()
+{
+  return getImage(mapFromScene(backgroundRect()).boundingRect().size());
+}
+
+QImage PlayGround::getImage(const QSize &size)
+{
+  QImage result(size, QImage::Format_ARGB32_Premultiplied);
+  result.fill(Qt::transparent);
+  QPainter artist(&result);
+  const QPointF heldPos = putPickedItemInScene();
   scene()->render(&artist, QRectF(), backgroundRect(), Qt::IgnoreAspectRatio);
+  takePickedItemFromScene(heldPos);
   artist.end();
   return result;
 }
 
+TimeLapse *PlayGround::timeLapse()
+{
+  QUndoStack *stack = undoStack();
+  if (!m_gameboard || isSwitching() || m_newItem || m_dragItem || !stack || stack->index() == 0)
+    return nullptr;
+
+  Instrumentation::Scope scope("PlayGround::timeLapse");
+
+  // the same size getImage() gives
+  const QRectF background = backgroundRect();
+  TimeLapse *timeLapse = new TimeLapse(m_scenes.value(m_gameboardFile).gameboard, background, mapFromScene(background).boundingRect().size());
+
+  // One copy of every item, in the scene of the copy when it is in ours.
+  // Steps not redone are not part of the picture.
+  QHash<ToDraw *, ToDraw *> copies;
+  auto copyOf = [this, &copies, timeLapse](ToDraw *item) -> ToDraw *
+  {
+    ToDraw *&copy = copies[item];
+    if (!copy)
+    {
+      copy = new ToDraw(m_gameboard, item->element());
+      copy->setPos(item->pos());
+      copy->setZValue(item->zValue());
+      if (item->scene()) timeLapse->scene()->addItem(copy);
+    }
+    return copy;
+  };
+  foreach (QGraphicsItem *item, scene()->items())
+  {
+    if (item->type() == ToDraw::Type)
+      copyOf(static_cast<ToDraw *>(item));
+  }
+  for (int step = 0; step < stack->index(); ++step)
+  {
+    const Action *action = static_cast<const Action *>(stack->command(step));
+    timeLapse->addStep(action->clone(copyOf(action->item()), timeLapse->scene()));
+  }
+  return timeLapse;
+}
+
 void PlayGround::connectRedoAction(QAction *action)
 {
   connect(action, &QAction::triggered, &m_undoGroup, &QUndoGroup::redo);
   connect(&m_undoGroup, &QUndoGroup::canRedoChanged, action, &QAction::setEnabled);
+  action->setEnabled(m_undoGroup.canRedo());
 }
 
 void PlayGround::connectUndoAction(QAction *action)
 {
   connect(action, &QAction::triggered, &m_undoGroup, &QUndoGroup::undo);
   connect(&m_undoGroup, &QUndoGroup::canUndoChanged, action, &QAction::setEnabled);
+  action->setEnabled(m_undoGroup.canUndo());
+}
+
+// The actions go to another document
+void PlayGround::disconnectUndoRedoActions(QAction *undoAction, QAction *redoAction)
+{
+  disconnect(undoAction, nullptr, &m_undoGroup, nullptr);
+  disconnect(redoAction, nullptr, &m_undoGroup, nullptr);
+  disconnect(&m_undoGroup, nullptr, undoAction, nullptr);
+  disconnect(&m_undoGroup, nullptr, redoAction, nullptr);
 }
 
 // Mouse pressed event
 void PlayGround::mousePressEvent(QMouseEvent *event)
 {
-  if (m_gameboardFile.isEmpty()) return;
+  if (m_recorder) m_recorder->record(event);
+  finishResize(); // the pointer must map to where the objects really are
+
+  if (m_gameboardFile.isEmpty() || isSwitching()) return;
+
+  if (event->button() == Qt::MiddleButton && m_zoom > 1 && !m_newItem && !m_dragItem)
+  {
+    m_panning = true;
+    m_panPos = event->pos();
+    setCursor(Qt::ClosedHandCursor);
+    return;
+  }
 
   if (event->button() != Qt::LeftButton) return;
 
@@ -140,76 +287,200 @@ void PlayGround::mousePressEvent(QMouseEvent *event)
   else
   {
     // see if the user clicked on the warehouse of items
-    QPointF scenePos = mapToScene(event->pos());
-    QMap<QString, QString>::const_iterator it, itEnd;
-    it = m_objectsNameSound.constBegin();
-    itEnd = m_objectsNameSound.constEnd();
-    QString foundElem;
-    QRectF bounds;
-    for( ; foundElem.isNull() && it != itEnd; ++it)
-    {
-      bounds = m_SvgRenderer.boundsOnElement(it.key());
-      if (bounds.contains(scenePos)) foundElem = it.key();
-    }
+    const int foundElem = m_gameboard->objectAt(mapToScene(event->pos()));
 
-    if (!foundElem.isNull())
+    if (foundElem != -1)
     {
-      const double objectScale = m_objectsNameRatio.value(foundElem);
-      const QSizeF elementSize = m_SvgRenderer.boundsOnElement(foundElem).size() * objectScale;
+      const QSizeF elementSize = m_gameboard->geometry(foundElem).size;
       QPointF itemPos = mapToScene(event->pos());
       itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
 
-      m_callbacks->playSound(m_objectsNameSound.value(foundElem));
+      playSound(foundElem);
 
-      m_newItem = new ToDraw;
+      m_newItem = new ToDraw(m_gameboard, foundElem);
       m_newItem->setBeingDragged(true);
       m_newItem->setPos(clipPos(itemPos, m_newItem));
-      m_newItem->setSharedRenderer(&m_SvgRenderer);
-      m_newItem->setElementId(foundElem);
-      m_newItem->setZValue(m_nextZValue);
-      m_nextZValue++;
-      m_newItem->setTransform(QTransform::fromScale(objectScale, objectScale));
+      m_newItem->setZValue(takeNextZValue());
 
-      scene()->addItem(m_newItem);
+      // only added to the scene once laid down
+      updatePickedItem(pickedItemRect());
       setCursor(Qt::BlankCursor);
+      setPickedItemTracking(true);
     }
     else
     {
       // see if the user clicked on an already existent item
-      QGraphicsItem *dragItem = scene()->itemAt(mapToScene(event->pos()), QTransform());
+      QGraphicsItem *dragItem;
+      {
+        Instrumentation::Scope scope("PlayGround hit test");
+        dragItem = scene()->itemAt(mapToScene(event->pos()), QTransform());
+      }
       m_dragItem = qgraphicsitem_cast<ToDraw*>(dragItem);
       if (m_dragItem)
       {
-        QString elem = m_dragItem->elementId();
-
-        m_callbacks->playSound(m_objectsNameSound.value(elem));
+        playSound(m_dragItem->element());
         setCursor(Qt::BlankCursor);
         m_dragItem->setBeingDragged(true);
         m_itemDraggedPos = m_dragItem->pos();
+        // out of the index for the whole drag, put back once on release
+        scene()->removeItem(m_dragItem);
 
-        const QSizeF elementSize = m_dragItem->transform().mapRect(m_dragItem->unclippedRect()).size();
+        const QSizeF elementSize = m_dragItem->unclippedRect().size();
         QPointF itemPos = mapToScene(event->pos());
         itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
         m_dragItem->setPos(clipPos(itemPos, m_dragItem));
+        updatePickedItem(pickedItemRect());
+        setPickedItemTracking(true);
       }
     }
   }
 }
 
 void PlayGround::mouseMoveEvent(QMouseEvent *event)
+{
+  if (m_recorder) m_recorder->record(event);
+  finishResize();
+  if (isSwitching()) return;
+
+  if (m_panning)
+  {
+    panBy(event->pos() - m_panPos);
+    m_panPos = event->pos();
+    return;
+  }
+
+  if (!m_newItem && !m_dragItem) return;
+
+  // Moving the item more than once per frame is only work nobody sees.
+  // A move with no frame pending is shown at once, the ones that follow
+  // it within the frame wait for the frame to end.
+  m_pendingMovePos = event->pos();
+  if (m_pendingMoveTime < 0)
+    m_pendingMoveTime = Instrumentation::self()->now();
+  if (!m_coalesceMoves || !m_moveTimer.isActive())
+  {
+    applyPendingMove();
+    if (m_coalesceMoves) m_moveTimer.start(frameInterval());
+  }
+}
+
+// The end of a frame started by a move
+void PlayGround::flushPendingMove()
+{
+  if (m_pendingMoveTime < 0) return;
+  applyPendingMove();
+  m_moveTimer.start(frameInterval());
+}
+
+void PlayGround::applyPendingMove()
 {
   ToDraw *movingItem = m_newItem ? m_newItem : m_dragItem;
-  if (movingItem) {
-    QPointF itemPos = mapToScene(event->pos());
-    const QSizeF elementSize = movingItem->transform().mapRect(movingItem->unclippedRect()).size();
-    itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
+  if (!movingItem) return;
+
+  QPointF itemPos = mapToScene(m_pendingMovePos);
+  const QSizeF elementSize = movingItem->unclippedRect().size();
+  itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
+
+  const QRectF oldRect = pickedItemRect();
+  movingItem->setPos(clipPos(itemPos, movingItem));
+  updatePickedItem(oldRect);
+  updatePickedItem(pickedItemRect());
+  m_dragFrameStart = m_pendingMoveTime;
+  m_pendingMoveTime = -1;
+}
 
-    movingItem->setPos(clipPos(itemPos, movingItem));
+// The item following the pointer is not in the scene, so that moving it
+// costs no index update on boards with many objects. drawForeground()
+// draws it until it is laid down.
+QRectF PlayGround::pickedItemRect() const
+{
+  const ToDraw *item = m_newItem ? m_newItem : m_dragItem;
+  return item ? item->unclippedRect().translated(item->pos()) : QRectF();
+}
+
+void PlayGround::updatePickedItem(const QRectF &sceneRect)
+{
+  if (!sceneRect.isEmpty())
+    viewport()->update(mapFromScene(sceneRect).boundingRect().adjusted(-2, -2, 2, 2));
+}
+
+// Back where it came from, or gone when it came from the warehouse
+void PlayGround::cancelPickedItem()
+{
+  if (!m_newItem && !m_dragItem) return;
+
+  updatePickedItem(pickedItemRect());
+  if (m_dragItem)
+  {
+    m_dragItem->setBeingDragged(false);
+    m_dragItem->setPos(m_itemDraggedPos);
+    scene()->addItem(m_dragItem);
   }
+  delete m_newItem;
+  m_newItem = nullptr;
+  m_dragItem = nullptr;
+  setCursor(QCursor());
+  setPickedItemTracking(false);
+}
+
+// The object held is only drawn by the view, saving or taking a picture
+// meanwhile has it where it was picked from, or where a new one is now.
+// Returns where it was, for takePickedItemFromScene().
+QPointF PlayGround::putPickedItemInScene()
+{
+  ToDraw *item = m_dragItem ? m_dragItem : m_newItem;
+  if (!item) return QPointF();
+
+  const QPointF heldPos = item->pos();
+  item->setBeingDragged(false);
+  if (m_dragItem) item->setPos(m_itemDraggedPos);
+  scene()->addItem(item);
+  return heldPos;
+}
+
+void PlayGround::takePickedItemFromScene(const QPointF &heldPos)
+{
+  ToDraw *item = m_dragItem ? m_dragItem : m_newItem;
+  if (!item) return;
+
+  scene()->removeItem(item);
+  item->setPos(heldPos);
+  item->setBeingDragged(true);
+}
+
+// Without an item following the pointer there is nothing to do on moves, do not even get them
+void PlayGround::setPickedItemTracking(bool tracking)
+{
+  m_moveTimer.stop();
+  m_pendingMoveTime = -1;
+  setMouseTracking(tracking);
+  viewport()->setMouseTracking(tracking);
+}
+
+int PlayGround::frameInterval() const
+{
+  const QWindow *windowHandle = window()->windowHandle();
+  const QScreen *screen = windowHandle ? windowHandle->screen() : QGuiApplication::primaryScreen();
+  const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+  return qMax(1, qRound(1000 / refreshRate));
 }
 
 void PlayGround::mouseReleaseEvent(QMouseEvent *event)
 {
+  if (m_recorder) m_recorder->record(event);
+  finishResize();
+  if (isSwitching()) return;
+
+  if (m_panning)
+  {
+    if (event->button() == Qt::MiddleButton)
+    {
+      m_panning = false;
+      setCursor(QCursor());
+    }
+    return;
+  }
+
   QPoint point = event->pos() - m_mousePressPos;
   if (m_allowOnlyDrag || point.manhattanLength() > qApp->startDragDistance()) {
       if (m_dragItem) placeDraggedItem(event->pos());
@@ -224,32 +495,37 @@ bool PlayGround::insideBackground(const QSizeF &size, const QPointF &pos) const
 
 QPointF PlayGround::clipPos(const QPointF &p, ToDraw *item) const
 {
-  const qreal objectScale = m_objectsNameRatio.value(item->elementId());
+  // only dragged items get clipped, so their bounding rect is the whole element
+  const QRectF &clipRect = m_gameboard->geometry(item->element()).clipRect;
 
   QPointF res = p;
-  res.setX(qMax(qreal(0), res.x()));
-  res.setY(qMax(qreal(0), res.y()));
-  res.setX(qMin(m_SvgRenderer.defaultSize().width() - item->boundingRect().width() * objectScale, res.x()));
-  res.setY(qMin(m_SvgRenderer.defaultSize().height()- item->boundingRect().height() * objectScale, res.y()));
+  res.setX(qMax(clipRect.left(), res.x()));
+  res.setY(qMax(clipRect.top(), res.y()));
+  res.setX(qMin(clipRect.right(), res.x()));
+  res.setY(qMin(clipRect.bottom(), res.y()));
   return res;
 }
 
 QRectF PlayGround::backgroundRect() const
 {
-  return m_SvgRenderer.boundsOnElement(QStringLiteral( "background" ));
+  return m_gameboard->backgroundRect();
 }
 
 void PlayGround::placeDraggedItem(const QPoint &pos)
 {
+  // laid down where the last move took it, not where the last frame showed it
+  flushPendingMove();
+
   QPointF itemPos = mapToScene(pos);
-  const QSizeF &elementSize = m_dragItem->transform().mapRect(m_dragItem->unclippedRect()).size();
+  const QSizeF &elementSize = m_dragItem->unclippedRect().size();
   itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
 
+  updatePickedItem(pickedItemRect());
+  scene()->addItem(m_dragItem);
   if (insideBackground(elementSize, itemPos))
   {
     m_dragItem->setBeingDragged(false);
-    undoStack()->push(new ActionMove(m_dragItem, m_itemDraggedPos, m_nextZValue, scene()));
-    m_nextZValue++;
+    undoStack()->push(new ActionMove(m_dragItem, m_itemDraggedPos, takeNextZValue(), scene()));
   }
   else
   {
@@ -257,31 +533,175 @@ void PlayGround::placeDraggedItem(const QPoint &pos)
   }
 
   setCursor(QCursor());
+  setPickedItemTracking(false);
   m_dragItem = 0;
 }
 
 void PlayGround::placeNewItem(const QPoint &pos)
 {
-  const QSizeF elementSize = m_newItem->transform().mapRect(m_newItem->unclippedRect()).size();
+  flushPendingMove();
+  const QSizeF elementSize = m_newItem->unclippedRect().size();
   QPointF itemPos = mapToScene(pos);
   itemPos -= QPointF(elementSize.width()/2, elementSize.height()/2);
+  updatePickedItem(pickedItemRect());
   if (insideBackground(elementSize, itemPos))
   {
     m_newItem->setBeingDragged(false);
+    scene()->addItem(m_newItem);
     undoStack()->push(new ActionAdd(m_newItem, scene()));
   } else {
-    m_newItem->deleteLater();
+    delete m_newItem;
   }
   m_newItem = 0;
   setCursor(QCursor());
+  setPickedItemTracking(false);
+}
+
+void PlayGround::playSound(int element)
+{
+  const int sound = m_gameboard->sound(element);
+  if (sound != -1) m_callbacks->playSound(m_gameboard, sound);
 }
 
 void PlayGround::recenterView()
 {
+  m_resizeTimer.stop();
+  m_resizePreview = QPixmap();
+
+  if (!m_gameboard) return;
+
   // Cannot use sceneRect() because sometimes items get placed
   // with pos() outside rect (e.g. pizza theme)
-  fitInView(QRect(QPoint(0,0), m_SvgRenderer.defaultSize()),
+  fitInView(QRect(QPoint(0,0), m_gameboard->defaultSize()),
       m_lockAspect ? Qt::KeepAspectRatio : Qt::IgnoreAspectRatio);
+
+  if (m_zoom > 1)
+  {
+    scale(m_zoom, m_zoom);
+    centerOn(m_zoomCenter);
+  }
+}
+
+// Zoom keeping the scene point under anchor, in viewport coordinates, where it is
+void PlayGround::zoomBy(qreal factor, const QPointF &anchor)
+{
+  const qreal zoom = qBound(qreal(1), m_zoom * factor, maxZoom);
+  if (zoom == m_zoom) return;
+
+  Instrumentation::Scope scope("PlayGround::zoomBy");
+
+  const QPointF anchorScenePos = mapToScene(anchor.toPoint());
+  m_zoom = zoom;
+  recenterView();
+
+  const QPointF fromCenter = QPointF(viewport()->rect().center()) - anchor;
+  centerOn(anchorScenePos + QPointF(fromCenter.x() / transform().m11(), fromCenter.y() / transform().m22()));
+  m_zoomCenter = mapToScene(viewport()->rect().center());
+}
+
+void PlayGround::panBy(const QPointF &delta)
+{
+  horizontalScrollBar()->setValue(horizontalScrollBar()->value() - qRound(delta.x()));
+  verticalScrollBar()->setValue(verticalScrollBar()->value() - qRound(delta.y()));
+  m_zoomCenter = mapToScene(viewport()->rect().center());
+}
+
+void PlayGround::wheelEvent(QWheelEvent *event)
+{
+  // the item following the pointer would jump around
+  if (!m_gameboard || isSwitching() || m_newItem || m_dragItem)
+  {
+    event->ignore();
+    return;
+  }
+
+  finishResize();
+  // a wheel notch is 120
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+  zoomBy(qPow(1.25, event->angleDelta().y() / 120.0), event->position());
+#else
+  zoomBy(qPow(1.25, event->angleDelta().y() / 120.0), event->pos());
+#endif
+  event->accept();
+}
+
+bool PlayGround::viewportEvent(QEvent *event)
+{
+  if (event->type() == QEvent::Gesture && m_gameboard && !isSwitching())
+  {
+    QGestureEvent *gestureEvent = static_cast<QGestureEvent *>(event);
+    QPinchGesture *pinch = static_cast<QPinchGesture *>(gestureEvent->gesture(Qt::PinchGesture));
+    if (pinch)
+    {
+      finishResize();
+      const QPointF center = viewport()->mapFromGlobal(pinch->centerPoint().toPoint());
+      if (pinch->changeFlags() & QPinchGesture::ScaleFactorChanged)
+        zoomBy(pinch->scaleFactor(), center);
+      if (pinch->changeFlags() & QPinchGesture::CenterPointChanged)
+        panBy(pinch->centerPoint() - pinch->lastCenterPoint());
+      gestureEvent->accept(pinch);
+      return true;
+    }
+  }
+  return QGraphicsView::viewportEvent(event);
+}
+
+qreal PlayGround::takeNextZValue()
+{
+  SceneData &data = m_scenes[m_gameboardFile];
+  if (data.nextZValue > data.zCompactionLimit) compactZValues();
+  return data.nextZValue++;
+}
+
+// Every pick and move puts an item on top, so Z values only ever grow.
+// Replace the ones in use, be it by items in the scene or in the undo
+// history, by their ranks so that the stacking order stays the same.
+void PlayGround::compactZValues()
+{
+  SceneData &data = m_scenes[m_gameboardFile];
+
+  QSet<ToDraw *> items;
+  foreach (QGraphicsItem *item, data.scene->items())
+  {
+    ToDraw *currentObject = qgraphicsitem_cast<ToDraw *>(item);
+    if (currentObject) items << currentObject;
+  }
+
+  QVector<Action *> actions;
+  for (int i = 0; i < data.undoStack->count(); ++i)
+  {
+    // all the commands we push are actions
+    Action *action = static_cast<Action *>(const_cast<QUndoCommand *>(data.undoStack->command(i)));
+    items << action->item();
+    actions << action;
+  }
+
+  QVector<qreal> zValues;
+  foreach (ToDraw *item, items) zValues << item->zValue();
+  foreach (Action *action, actions) action->zValues(zValues);
+  std::sort(zValues.begin(), zValues.end());
+  zValues.erase(std::unique(zValues.begin(), zValues.end()), zValues.end());
+
+  // ranks start at 1, the background stays below at 0
+  QHash<qreal, qreal> ranks;
+  ranks.reserve(zValues.count());
+  for (int i = 0; i < zValues.count(); ++i) ranks.insert(zValues[i], i + 1);
+
+  foreach (ToDraw *item, items) item->setZValue(ranks.value(item->zValue()));
+  foreach (Action *action, actions) action->remapZValues(ranks);
+
+  data.nextZValue = zValues.count() + 1;
+  data.zCompactionLimit = 2 * zValues.count() + zCompactionSlack;
+}
+
+// Size the BSP tree for twice the items we have so that adding
+// items does not keep regenerating it. Dragged items leave the index
+// for the whole drag, see pickedItemRect().
+void PlayGround::tuneSceneIndex(int itemCount)
+{
+  int depth = 5; // what QGraphicsScene starts with
+  while (depth < 16 && (1 << depth) < 2 * itemCount) depth++;
+  scene()->setBspTreeDepth(depth);
 }
 
 QGraphicsScene *PlayGround::scene() const
@@ -294,9 +714,123 @@ QUndoStack *PlayGround::undoStack() const
   return m_scenes[m_gameboardFile].undoStack;
 }
 
-void PlayGround::resizeEvent(QResizeEvent *)
+// Rendering the whole board again at each step of an interactive resize
+// or when going full screen lags, show the last frame scaled meanwhile
+void PlayGround::resizeEvent(QResizeEvent *event)
 {
+  // when zoomed in the board is mostly off screen, no preview of it
+  if (!m_gameboard || !isVisible() || event->oldSize().isEmpty() || m_zoom > 1)
+  {
+    recenterView();
+    return;
+  }
+
+  if (m_resizePreview.isNull())
+  {
+    Instrumentation::Scope scope("PlayGround resize preview");
+
+    // the transform still is the one of the old size
+    const QRect boardRect = mapFromScene(QRectF(QPointF(0, 0), m_gameboard->defaultSize())).boundingRect();
+    const qreal dpr = devicePixelRatioF();
+    m_resizePreview = QPixmap(boardRect.size() * dpr);
+    m_resizePreview.setDevicePixelRatio(dpr);
+    m_resizePreview.fill(Qt::transparent);
+    QPainter painter(&m_resizePreview);
+    render(&painter, QRectF(QPointF(0, 0), boardRect.size()), boardRect, Qt::IgnoreAspectRatio);
+    painter.end();
+    m_resizeStartSize = event->oldSize();
+  }
+
+  if (event->size() == m_resizeStartSize)
+  {
+    // back where we started, what is on screen is still right
+    m_resizeTimer.stop();
+    m_resizePreview = QPixmap();
+  }
+  else
+  {
+    m_resizeTimer.start();
+  }
+  viewport()->update();
+}
+
+void PlayGround::finishResize()
+{
+  if (m_resizePreview.isNull()) return;
+
   recenterView();
+  viewport()->update();
+}
+
+void PlayGround::paintEvent(QPaintEvent *event)
+{
+  Instrumentation::Scope scope("PlayGround::paintEvent");
+
+  // dimmed, so that it does not look like it takes input
+  if (!m_switchPlaceholder.isNull())
+  {
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), backgroundBrush());
+    painter.setOpacity(0.5);
+    painter.drawPixmap(viewport()->rect(), m_switchPlaceholder);
+    return;
+  }
+
+  if (!m_resizePreview.isNull())
+  {
+    const QSizeF previewSize = m_resizePreview.size() / m_resizePreview.devicePixelRatio();
+    QRectF target(QPointF(0, 0), previewSize.scaled(viewport()->size(), m_lockAspect ? Qt::KeepAspectRatio : Qt::IgnoreAspectRatio));
+    target.moveCenter(QRectF(viewport()->rect()).center());
+
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), backgroundBrush());
+    painter.drawPixmap(target, m_resizePreview, QRectF(m_resizePreview.rect()));
+    return;
+  }
+
+  QElapsedTimer frameTime;
+  frameTime.start();
+  QGraphicsView::paintEvent(event);
+  PerformanceCounters::self()->addFrameTime(frameTime.nsecsElapsed());
+
+  // From the pointer move to the frame showing the item there
+  if (m_dragFrameStart >= 0)
+  {
+    Instrumentation *instrumentation = Instrumentation::self();
+    if (instrumentation->isEnabled())
+      instrumentation->addDuration("drag frame", m_dragFrameStart, instrumentation->now() - m_dragFrameStart);
+    m_dragFrameStart = -1;
+  }
+}
+
+void PlayGround::drawForeground(QPainter *painter, const QRectF &rect)
+{
+  QGraphicsView::drawForeground(painter, rect);
+
+  ToDraw *pickedItem = m_newItem ? m_newItem : m_dragItem;
+  if (pickedItem && pickedItemRect().intersects(rect))
+  {
+    painter->save();
+    painter->translate(pickedItem->pos());
+    pickedItem->paint(painter, nullptr, nullptr);
+    painter->restore();
+  }
+
+  if (!Instrumentation::self()->isEnabled()) return;
+
+  // The numbers are those of the previous frames, this one is not finished yet
+  painter->save();
+  painter->resetTransform();
+  QFont font = painter->font();
+  font.setStyleHint(QFont::Monospace);
+  font.setFamily(QStringLiteral("monospace"));
+  painter->setFont(font);
+  const QString text = Instrumentation::self()->overlayText();
+  const QRect textRect = painter->boundingRect(viewport()->rect().adjusted(8, 8, -8, -8), Qt::AlignLeft | Qt::AlignTop, text);
+  painter->fillRect(textRect.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+  painter->setPen(Qt::white);
+  painter->drawText(textRect, Qt::AlignLeft | Qt::AlignTop, text);
+  painter->restore();
 }
 
 void PlayGround::lockAspectRatio(bool lock)
@@ -313,133 +847,297 @@ bool PlayGround::isAspectRatioLocked() const
   return m_lockAspect;
 }
 
-// Register the various playgrounds
-void PlayGround::registerPlayGrounds()
+// Record the mouse input from now on, see InputReplayer for playing it back
+bool PlayGround::startRecording(const QString &fileName)
 {
-  QSet<QString> list;
-  const QStringList dirs = FileFactory::locateAll(QStringLiteral("pics"));
-  Q_FOREACH (const QString &dir, dirs)
+  stopRecording();
+  if (m_gameboardFile.isEmpty()) return false;
+
+  m_recorder = new InputRecorder();
+  if (!m_recorder->start(fileName, this))
   {
-    const QStringList fileNames = QDir(dir).entryList(QStringList() << QStringLiteral("*.theme"));
-    Q_FOREACH (const QString &file, fileNames)
-    {
-        list << dir + '/' + file;
-    }
+    stopRecording();
+    return false;
   }
+  return true;
+}
 
-  QMap<QString, QPair<QString, QPixmap>> sortedByName;
-
-  foreach(const QString &theme, list)
+// Stress mode, throws lots of random objects on the board
+void PlayGround::fillWithRandomItems(int count)
+{
+  if (m_gameboardFile.isEmpty() || m_gameboard->objects().isEmpty()) return;
+
+  const QVector<int> &objects = m_gameboard->objects();
+  const QRectF background = backgroundRect();
+  // The same count gives the same board. The raw numbers of the generator
+  // are the same everywhere, those of the std distributions are not.
+  std::mt19937 random(count);
+  const qreal randomMax = std::mt19937::max();
+  for (int i = 0; i < count; i++)
   {
-    QFile layoutFile(theme);
-    if (layoutFile.open(QIODevice::ReadOnly))
-    {
-      QDomDocument layoutDocument;
-      if (layoutDocument.setContent(&layoutFile))
-      {
-        QString desktop = layoutDocument.documentElement().attribute(QStringLiteral( "desktop" ));
-        KConfig c( FileFactory::locate( QLatin1String( "pics/" ) + desktop ) );
-        KConfigGroup cg = c.group("KTuberlingTheme");
-        QString gameboard = layoutDocument.documentElement().attribute(QStringLiteral( "gameboard" ));
-        QPixmap pixmap(200,100);
-        pixmap.fill(Qt::transparent);
-        playGroundPixmap(gameboard,pixmap);
-        sortedByName.insertMulti(cg.readEntry("Name"), QPair<QString, QPixmap>(theme, pixmap));
-      }
-    }
+    ToDraw *obj = new ToDraw(m_gameboard, objects.at(random() % objects.count()));
+    const QSizeF elementSize = obj->unclippedRect().size();
+    obj->setPos(background.x() + (background.width() - elementSize.width()) * (random() / randomMax),
+                background.y() + (background.height() - elementSize.height()) * (random() / randomMax));
+    obj->setZValue(takeNextZValue());
+
+    scene()->addItem(obj);
+    undoStack()->push(new ActionAdd(obj, scene()));
   }
 
-  for(auto it = sortedByName.begin(); it != sortedByName.end(); ++it) {
-    m_callbacks->registerGameboard(it.key(), it.value().first, it.value().second);
+  tuneSceneIndex(scene()->items().count());
+}
+
+// What is in the scenes and their undo history, for the performance counters
+QVariantMap PlayGround::sceneStatistics() const
+{
+  int totalItems = 0;
+  int undoCommands = 0;
+  qint64 undoBytes = 0;
+  foreach (const SceneData &data, m_scenes)
+  {
+    totalItems += data.scene->items().count() - 1; // not the background
+    undoCommands += data.undoStack->count();
+    for (int i = 0; i < data.undoStack->count(); ++i)
+      undoBytes += static_cast<const Action *>(data.undoStack->command(i))->memoryUsage();
   }
 
+  QVariantMap statistics;
+  statistics.insert(QStringLiteral("gameboard"), m_gameboardFile);
+  statistics.insert(QStringLiteral("items"), m_gameboardFile.isEmpty() ? 0 : scene()->items().count() - 1);
+  statistics.insert(QStringLiteral("cachedScenes"), m_scenes.count());
+  statistics.insert(QStringLiteral("totalItems"), totalItems);
+  statistics.insert(QStringLiteral("undoCommands"), undoCommands);
+  statistics.insert(QStringLiteral("undoBytes"), undoBytes);
+  return statistics;
 }
 
-void PlayGround::playGroundPixmap(const QString &playgroundName, QPixmap &pixmap)
+void PlayGround::stopRecording()
 {
-  m_SvgRenderer.load(FileFactory::locate(QLatin1String( "pics/" ) + playgroundName ));
-  QPainter painter(&pixmap);
-  m_SvgRenderer.render(&painter,QStringLiteral( "background" ));
+  delete m_recorder;
+  m_recorder = nullptr;
 }
 
-// Load background and draggable objects masks
-bool PlayGround::loadPlayGround(const QString &gameboardFile)
+bool PlayGround::isEvictable(const QString &gameboardFile) const
 {
-  QDomNodeList playGroundsList,
-               editableAreasList, objectsList,
-               gameAreasList, maskAreasList, soundNamesList, labelsList;
-  QDomElement playGroundElement,
-              editableAreaElement, objectElement,
-              gameAreaElement, maskAreaElement, soundNameElement, labelElement;
-  QDomAttr gameboardAttribute, masksAttribute,
-           leftAttribute, topAttribute, rightAttribute, bottomAttribute,
-           refAttribute;
+  const SceneData &data = m_scenes.constFind(gameboardFile).value();
+  return gameboardFile != m_gameboardFile && data.undoStack->count() == 0 && data.scene->items().count() == 1;
+}
 
-  QFile layoutFile(gameboardFile);
-  if (!layoutFile.open(QIODevice::ReadOnly)) return false;
-  QDomDocument layoutDocument;
-  if (!layoutDocument.setContent(&layoutFile)) return false;
+// The objects laid down, and the undo commands with the objects they keep for later
+qint64 PlayGround::sceneBytes(const SceneData &data) const
+{
+  const qint64 items = data.scene->items().count() - 1;
+  qint64 bytes = emptySceneBytes + items * qint64(sizeof(ToDraw) + itemOverheadBytes);
+  for (int i = 0; i < data.undoStack->count(); ++i)
+    bytes += static_cast<const Action *>(data.undoStack->command(i))->memoryUsage();
+  return bytes;
+}
 
-  playGroundElement = layoutDocument.documentElement();
+qint64 PlayGround::memoryUsed() const
+{
+  qint64 used = 0;
+  for (const SceneData &data : m_scenes)
+    used += sceneBytes(data);
+  for (const SceneData &data : m_evictedScenes)
+    used += sceneBytes(data);
+  return used;
+}
 
-  QString gameboardName = playGroundElement.attribute(QStringLiteral( "gameboard" ));
+qint64 PlayGround::memoryEvictable() const
+{
+  qint64 used = 0;
+  for (QMap<QString, SceneData>::const_iterator it = m_scenes.constBegin(); it != m_scenes.constEnd(); ++it)
+  {
+    if (isEvictable(it.key()))
+      used += sceneBytes(it.value());
+  }
+  return used;
+}
 
-  QColor bgColor = QColor(playGroundElement.attribute(QStringLiteral( "bgcolor" ), QStringLiteral( "#fff" ) ) );
-  if (!bgColor.isValid())
-    bgColor = Qt::white;
+qint64 PlayGround::evict(qint64 bytes)
+{
+  qint64 freed = 0;
+  QMap<QString, SceneData>::iterator it = m_scenes.begin();
+  while (it != m_scenes.end() && freed < bytes)
+  {
+    if (!isEvictable(it.key()))
+    {
+      ++it;
+      continue;
+    }
 
-  if (!m_SvgRenderer.load(FileFactory::locate( QLatin1String( "pics/" ) + gameboardName )))
-    return false;
+    // the budget may be checked from within one of its items, e.g. a
+    // background level that finished rendering, so they go later
+    freed += sceneBytes(it.value());
+    m_evictedScenes << it.value();
+    it = m_scenes.erase(it);
+  }
+  if (freed > 0)
+    QTimer::singleShot(0, this, &PlayGround::deleteEvictedScenes);
+  return freed;
+}
 
-  objectsList = playGroundElement.elementsByTagName(QStringLiteral( "object" ));
-  if (objectsList.count() < 1)
-    return false;
+// The scenes first, their items point to the gameboards the scene data holds
+void PlayGround::deleteEvictedScenes()
+{
+  foreach (const SceneData &data, m_evictedScenes)
+  {
+    delete data.scene;
+    delete data.undoStack;
+  }
+  m_evictedScenes.clear();
+}
 
-  m_objectsNameSound.clear();
+// Register the various playgrounds
+void PlayGround::registerPlayGrounds()
+{
+  GameboardRepository::self()->registerThemes(m_callbacks, this);
+}
+
+// A theme changed on disk, apply it to its cached scene keeping the objects laid down on it
+void PlayGround::gameboardChanged(const QString &themeFile)
+{
+  if (!m_scenes.contains(themeFile)) return;
+
+  Instrumentation::Scope scope("PlayGround::gameboardChanged");
+
+  SceneData &data = m_scenes[themeFile];
+  data.scene->setSceneRect(QRectF(QPointF(0, 0), data.gameboard->defaultSize()));
+  data.background->gameboardChanged();
+  foreach (QGraphicsItem *item, data.scene->items())
+  {
+    ToDraw *currentObject = qgraphicsitem_cast<ToDraw *>(item);
+    if (currentObject) currentObject->gameboardChanged();
+  }
+
+  if (themeFile == m_gameboardFile)
+  {
+    setBackgroundBrush(m_gameboard->backgroundColor());
+    recenterView();
+  }
+}
+
+// Load background and draggable objects masks
+bool PlayGround::loadPlayGround(const QString &gameboardFile)
+{
+  Instrumentation::Scope loadScope("PlayGround::loadPlayGround");
+  cancelSwitch();
+  // it belongs to the scene being left
+  if (!m_gameboardFile.isEmpty()) cancelPickedItem();
 
-  // create scene data if needed
-  if(!m_scenes.contains(gameboardFile))
+  // create scene data if needed, the gameboard may be shown by other documents already
+  if (!m_scenes.contains(gameboardFile))
   {
+    QSharedPointer<Gameboard> gameboard = GameboardRepository::self()->gameboard(gameboardFile);
+    if (!gameboard) return false;
+
+    PerformanceCounters::self()->cacheMiss(PerformanceCounters::SceneCache);
+    Instrumentation::Scope scope("loadPlayGround: create scene");
+
     SceneData &data = m_scenes[gameboardFile];
-    data.scene = new QGraphicsScene();
+    data.gameboard = gameboard;
+    // A fixed scene rect keeps the index from being regenerated as items move around
+    data.scene = new QGraphicsScene(QRectF(QPointF(0, 0), gameboard->defaultSize()));
     data.undoStack = new QUndoStack();
+    data.nextZValue = 1;
+    data.zCompactionLimit = zCompactionSlack;
 
-    QGraphicsSvgItem *background = new QGraphicsSvgItem();
-    background->setPos(QPoint(0,0));
-    background->setSharedRenderer(&m_SvgRenderer);
-    background->setZValue(0);
-    data.scene->addItem(background);
+    data.background = new BackgroundItem(gameboard.data());
+    data.scene->addItem(data.background);
 
     m_undoGroup.addStack(data.undoStack);
   }
-
-  for (int decoration = 0; decoration < objectsList.count(); decoration++)
+  else
   {
-    objectElement = (const QDomElement &) objectsList.item(decoration).toElement();
-
-    const QString &objectName = objectElement.attribute(QStringLiteral( "name" ));
-    if (m_SvgRenderer.elementExists(objectName))
-    {
-      m_objectsNameSound.insert(objectName, objectElement.attribute(QStringLiteral( "sound" )));
-      m_objectsNameRatio.insert(objectName, objectElement.attribute(QStringLiteral( "scale" ), QStringLiteral( "1" )).toDouble());
-    }
-    else
-    {
-      qWarning() << objectName << "does not exist. Check" << gameboardFile;
-    }
+    PerformanceCounters::self()->cacheHit(PerformanceCounters::SceneCache);
   }
 
-  setBackgroundBrush(bgColor);
   m_gameboardFile = gameboardFile;
+  m_gameboard = m_scenes[gameboardFile].gameboard.data();
+  setBackgroundBrush(m_gameboard->backgroundColor());
+  m_zoom = 1;
   setScene(scene());
 
-  recenterView();
+  {
+    Instrumentation::Scope scope("loadPlayGround: recenter");
+    recenterView();
+  }
 
   m_undoGroup.setActiveStack(undoStack());
 
+  // the scene left may be empty, and a new one may have pushed past the budget
+  MemoryBudget::self()->checkBudget();
+
   return true;
 }
 
+// Only the parsing and the SVG loading are worth another thread, the
+// scene gets created here once the gameboard is there
+void PlayGround::switchPlayGround(const QString &gameboardFile)
+{
+  if (gameboardFile == m_gameboardFile && !isSwitching()) return;
+
+  if (m_scenes.contains(gameboardFile) || GameboardRepository::self()->isLoaded(gameboardFile))
+  {
+    const bool ok = loadPlayGround(gameboardFile);
+    emit playGroundLoaded(gameboardFile, ok);
+    return;
+  }
+
+  // the picture of the board, not of a placeholder shown already
+  if (!isSwitching() && m_gameboard)
+  {
+    finishResize();
+    m_switchPlaceholder = viewport()->grab();
+  }
+  cancelSwitch();
+  m_switchingTo = gameboardFile;
+  const int generation = m_switchGeneration;
+  viewport()->update();
+
+  QFutureWatcher<QSharedPointer<Gameboard>> *watcher = new QFutureWatcher<QSharedPointer<Gameboard>>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, gameboardFile, generation]() {
+    watcher->deleteLater();
+    if (generation != m_switchGeneration) return;
+
+    // held until the scene holds it
+    const QSharedPointer<Gameboard> gameboard = GameboardRepository::self()->adoptGameboard(gameboardFile, watcher->result());
+    const bool ok = gameboard && loadPlayGround(gameboardFile);
+    cancelSwitch();
+    emit playGroundLoaded(gameboardFile, ok);
+  });
+  watcher->setFuture(GameboardRepository::self()->loadInBackground(gameboardFile));
+}
+
+bool PlayGround::isSwitching() const
+{
+  return !m_switchingTo.isEmpty();
+}
+
+QString PlayGround::switchingTo() const
+{
+  return m_switchingTo;
+}
+
+// The result of the switch in flight, if any, gets dropped
+void PlayGround::cancelSwitch()
+{
+  m_switchGeneration++;
+  if (!isSwitching()) return;
+
+  m_switchingTo.clear();
+  m_switchPlaceholder = QPixmap();
+  viewport()->update();
+}
+
+// The overlay changes with every frame, partial updates would leave old numbers around
+void PlayGround::setInstrumentationShown(bool shown)
+{
+  setViewportUpdateMode(shown ? FullViewportUpdate : MinimalViewportUpdate);
+  viewport()->update();
+}
+
 void PlayGround::setAllowOnlyDrag(bool allowOnlyDrag)
 {
   m_allowOnlyDrag = allowOnlyDrag;
@@ -454,76 +1152,72 @@ QString PlayGround::currentGameboard() const
 PlayGround::LoadError PlayGround::loadFrom(const QString &name)
 {
   QFile f(name);
-  if (!f.open(QIODevice::ReadOnly))
-      return OtherError;
-
-  QDataStream in(&f);
-  in.setVersion(QDataStream::Qt_4_5);
-
-  bool scale = false;
-  bool reopenInTextMode = false;
-  QString magicText;
-  in >> magicText;
-  if ( QLatin1String( saveGameTextScaleTextMode ) == magicText) {
-      scale = true;
-      reopenInTextMode = true;
-  } else if (QLatin1String( saveGameTextTextMode ) == magicText) {
-      reopenInTextMode = true;
-  } else if ( QLatin1String( saveGameText ) != magicText) {
-      return OldFileVersionError;
-  }
+  return loadFrom(&f);
+}
 
-  if (reopenInTextMode) {
-      f.close();
-      if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
-        return OtherError;
-      in.setDevice(&f);
-      in.setVersion(QDataStream::Qt_4_5);
-      in >> magicText;
+// Same as above but reading from a not yet opened device, e.g. a download buffer
+PlayGround::LoadError PlayGround::loadFrom(QIODevice *device)
+{
+  SaveGameReader reader;
+  switch (reader.open(device))
+  {
+    case SaveGameReader::NoError: break;
+    case SaveGameReader::OldFileVersionError: return OldFileVersionError;
+    case SaveGameReader::OtherError: return OtherError;
   }
 
-  sceneRect();
-
-  if (in.atEnd())
-    return OtherError;
-
-  QString board;
-  in >> board;
-
+  const bool scale = reader.needsScaling();
   qreal xFactor = 1.0;
   qreal yFactor = 1.0;
-  m_callbacks->changeGameboard(board);
+
+  // this document's board, whichever one is shown
+  const QString gameboardFile = FileFactory::locate(QLatin1String( "pics/" ) + reader.gameboard());
+  if (gameboardFile.isEmpty())
+    return OtherError;
+  if (gameboardFile != m_gameboardFile || isSwitching())
+  {
+    if (!loadPlayGround(gameboardFile))
+      return OtherError;
+    emit playGroundLoaded(gameboardFile, true);
+  }
 
   reset();
 
   if (scale) {
-    QSize defaultSize = m_SvgRenderer.defaultSize();
+    QSize defaultSize = m_gameboard->defaultSize();
     QSize currentSize = size();
     xFactor = (qreal)defaultSize.width() / (qreal)currentSize.width();
     yFactor = (qreal)defaultSize.height() / (qreal)currentSize.height();
   }
 
-  while ( !in.atEnd() )
+  int itemCount = 0;
+  qreal maxZValue = 0;
+  SaveGameReader::Item item;
+  while ( !reader.atEnd() )
   {
-    ToDraw *obj = new ToDraw;
-    if (!obj->load(in))
-    {
-      delete obj;
+    if (!reader.readItem(&item))
       return OtherError;
-    }
-    obj->setSharedRenderer(&m_SvgRenderer);
-    double objectScale = m_objectsNameRatio.value(obj->elementId());
-    obj->setTransform(QTransform::fromScale(objectScale, objectScale));
+
+    ToDraw *obj = new ToDraw(m_gameboard, m_gameboard->element(item.element));
     if (scale) { // Mimic old behavior
-      QPointF storedPos = obj->pos();
-      storedPos.setX(storedPos.x() * xFactor);
-      storedPos.setY(storedPos.y() * yFactor);
-      obj->setPos(storedPos);
+      item.pos.setX(item.pos.x() * xFactor);
+      item.pos.setY(item.pos.y() * yFactor);
     }
+    obj->setPos(item.pos);
+    obj->setZValue(item.z);
     scene()->addItem(obj);
     undoStack()->push(new ActionAdd(obj, scene()));
+    maxZValue = qMax(maxZValue, obj->zValue());
+    itemCount++;
   }
-  if (f.error() == QFile::NoError) return NoError;
+
+  SceneData &data = m_scenes[m_gameboardFile];
+  data.nextZValue = qFloor(maxZValue) + 1;
+  data.zCompactionLimit = data.nextZValue + 2 * itemCount + zCompactionSlack;
+  tuneSceneIndex(itemCount);
+
+  QFileDevice *file = qobject_cast<QFileDevice *>(device);
+  if (!file || file->error() == QFile::NoError) return NoError;
   else return OtherError;
 }
 
@@ -15,27 +15,40 @@
 
 #include <QGraphicsView>
 #include <QMap>
+#include <QPixmap>
+#include <QSharedPointer>
 
-#include <QSvgRenderer>
+#include <QTimer>
 #include <QUndoGroup>
+#include <QVariantMap>
+
+#include "memorybudget.h"
 
 class KActionCollection;
 
 class Action;
+class BackgroundItem;
+class Gameboard;
+class InputRecorder;
+class TimeLapse;
 class ToDraw;
 class QPagedPaintDevice;
 class QGraphicsSvgItem;
+class QIODevice;
 
 class PlayGroundCallbacks
 {
 public:
   virtual ~PlayGroundCallbacks() {}
-  virtual void playSound(const QString &ref) = 0;
-  virtual void changeGameboard(const QString &gameboard) = 0;
-  virtual void registerGameboard(const QString& menuText, const QString& boardFile, const QPixmap& pixmap) = 0;
+  // sound is an id of the gameboard, see Gameboard::sound()
+  virtual void playSound(Gameboard *gameboard, int sound) = 0;
+  // gameboardFile is the SVG, for getting thumbnails from ThumbnailCache.
+  // Called again for the same boardFile when the theme changed on disk.
+  virtual void registerGameboard(const QString& menuText, const QString& boardFile, const QString& gameboardFile) = 0;
+  virtual void unregisterGameboard(const QString& boardFile) = 0;
 };
 
-class PlayGround : public QGraphicsView
+class PlayGround : public QGraphicsView, public MemoryBudget::Cache
 {
   Q_OBJECT
 
@@ -47,31 +60,71 @@ public:
 
   void reset();
   LoadError loadFrom(const QString &name);
+  LoadError loadFrom(QIODevice *device);
   bool saveAs(const QString &name);
+  bool saveAs(QIODevice *device);
   bool printPicture(QPagedPaintDevice &printer);
   QPixmap getPicture();
+  QImage getImage();
+  // The board at that size, whatever the view looks like
+  QImage getImage(const QSize &size);
+  // A copy of the board and of the undo history that led to it, for
+  // saving a picture of each step. Null when there is no history, or
+  // while the user holds an object.
+  TimeLapse *timeLapse();
 
   void connectRedoAction(QAction *action);
   void connectUndoAction(QAction *action);
+  void disconnectUndoRedoActions(QAction *undoAction, QAction *redoAction);
 
   void registerPlayGrounds();
   bool loadPlayGround(const QString &gameboardFile);
 
+  // Same as loadPlayGround() without waiting for the theme to be parsed:
+  // the board shown stays as a still picture taking no input until the new
+  // one is there, then playGroundLoaded() tells. Another switch or load
+  // meanwhile cancels it.
+  void switchPlayGround(const QString &gameboardFile);
+  bool isSwitching() const;
+  QString switchingTo() const;
+
   void setAllowOnlyDrag(bool allowOnlyDrag);
+  // Whether the instrumentation overlay is drawn, see Instrumentation::setEnabled()
+  void setInstrumentationShown(bool shown);
 
   QString currentGameboard() const;
 
   bool isAspectRatioLocked() const;
 
+  bool startRecording(const QString &fileName);
+  void stopRecording();
+
+  void fillWithRandomItems(int count);
+
+  QVariantMap sceneStatistics() const;
+
+  // Only empty scenes of other gameboards are evictable, the others hold the user's work
+  qint64 memoryUsed() const override;
+  qint64 memoryEvictable() const override;
+  qint64 evict(qint64 bytes) override;
+
 public Q_SLOTS:
   void lockAspectRatio(bool lock);
 
+Q_SIGNALS:
+  // After switchPlayGround(), or when a file loaded shows another gameboard
+  void playGroundLoaded(const QString &gameboardFile, bool ok);
+
 protected:
 
   void mousePressEvent(QMouseEvent *event) override;
   void mouseMoveEvent(QMouseEvent *event) override;
   void mouseReleaseEvent(QMouseEvent *event) override;
+  void wheelEvent(QWheelEvent *event) override;
+  bool viewportEvent(QEvent *event) override;
   void resizeEvent(QResizeEvent *event) override;
+  void paintEvent(QPaintEvent *event) override;
+  void drawForeground(QPainter *painter, const QRectF &rect) override;
 
 private:
   QPointF clipPos(const QPointF &p, ToDraw *item) const;
@@ -79,36 +132,79 @@ private:
   bool insideBackground(const QSizeF &size, const QPointF &pos) const;
   void placeDraggedItem(const QPoint &pos);
   void placeNewItem(const QPoint &pos);
-  void playGroundPixmap(const QString &playgroundName, QPixmap &pixmap);
+  void playSound(int element);
+  void setPickedItemTracking(bool tracking);
+  QRectF pickedItemRect() const;
+  void updatePickedItem(const QRectF &sceneRect);
+  void cancelPickedItem();
+  QPointF putPickedItemInScene();
+  void takePickedItemFromScene(const QPointF &heldPos);
+  void applyPendingMove();
+  void flushPendingMove();
+  int frameInterval() const;
 
   void recenterView();
+  void finishResize();
+  void zoomBy(qreal factor, const QPointF &anchor);
+  void panBy(const QPointF &delta);
+
+  void gameboardChanged(const QString &themeFile);
+  void cancelSwitch();
+  bool isEvictable(const QString &gameboardFile) const;
+  void deleteEvictedScenes();
+
+  qreal takeNextZValue();
+  void compactZValues();
+  void tuneSceneIndex(int itemCount);
   
   QGraphicsScene *scene() const;
   QUndoStack *undoStack() const;
 
   PlayGroundCallbacks *m_callbacks;
   QString m_gameboardFile;				// the file the board
-  QMap<QString, QString> m_objectsNameSound;		// map between element name and sound
-  QMap<QString, double> m_objectsNameRatio;		// map between element name and scaling ratio
 
   QPoint m_mousePressPos;
   QPointF m_itemDraggedPos;
   ToDraw *m_newItem;				    // the new item we are moving
   ToDraw *m_dragItem;					// the existing item we are dragging
-  QSvgRenderer m_SvgRenderer;				// the SVG renderer
-  int m_nextZValue;					// the next Z value to use
+  QPoint m_pendingMovePos;				// where the pointer last went, applied at most once per frame
+  QTimer m_moveTimer;
+  bool m_coalesceMoves;
+  qint64 m_pendingMoveTime;				// when the oldest move not shown yet happened, -1 for none
+  qint64 m_dragFrameStart;				// same, for the move the next paint shows
+  Gameboard *m_gameboard;				// the gameboard being shown, held by its scene data
+
+  QPixmap m_resizePreview;				// the board as it was before resizing started
+  QSize m_resizeStartSize;
+  QTimer m_resizeTimer;					// full renders wait for the size to settle
+
+  QString m_switchingTo;				// the gameboard being loaded in the background
+  QPixmap m_switchPlaceholder;				// the board shown until it is there
+  int m_switchGeneration;				// tells the last switch from the ones it cancelled
+
+  qreal m_zoom;						// on top of fitting the board in the view
+  QPointF m_zoomCenter;					// scene point in the middle of the view when zoomed
+  bool m_panning;
+  QPoint m_panPos;
 
   bool m_lockAspect;					// whether we are locking aspect ratio
   bool m_allowOnlyDrag;
   QUndoGroup m_undoGroup;
+  InputRecorder *m_recorder;				// records the mouse input when asked to
   
   class SceneData
   {
     public:
+      QSharedPointer<Gameboard> gameboard;	// shared by all the items of the scene, and other documents
+      BackgroundItem *background;
       QGraphicsScene *scene;
       QUndoStack *undoStack;
+      qreal nextZValue;				// the next Z value to use
+      qreal zCompactionLimit;			// renormalize Z values once nextZValue is past this
   };
   QMap <QString, SceneData> m_scenes;  // caches the items of each playground
+  QList<SceneData> m_evictedScenes;	// deleted once back in the event loop
+  qint64 sceneBytes(const SceneData &data) const;
 };
 
 #endif
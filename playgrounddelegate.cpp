@@ -18,8 +18,12 @@
 
 #include "playgrounddelegate.h"
 #include <QPainter>
+#include <QPaintDevice>
 
-PlaygroundDelegate::PlaygroundDelegate(QObject *parent): QAbstractItemDelegate(parent)
+#include "thumbnailcache.h"
+
+PlaygroundDelegate::PlaygroundDelegate(ThumbnailCache *thumbnails, int gameboardFileRole, QObject *parent)
+ : QAbstractItemDelegate(parent), m_thumbnails(thumbnails), m_gameboardFileRole(gameboardFileRole)
 { }
 
 QSize PlaygroundDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
@@ -32,7 +36,7 @@ QSize PlaygroundDelegate::sizeHint(const QStyleOptionViewItem& option, const QMo
 void PlaygroundDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
   QString title = index.model()->data(index, Qt::DisplayRole).toString();
-  QPixmap pixmap = index.model()->data(index,Qt::UserRole).value<QPixmap>();
+  const QString gameboardFile = index.model()->data(index, m_gameboardFileRole).toString();
 
   //Paint background with highlight
   painter->save();
@@ -44,8 +48,12 @@ void PlaygroundDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
   painter->drawRect(option.rect);
   painter->restore();
 
-  //Any way of do this more beatifuly?
-  painter->drawPixmap(option.rect.x()+4,option.rect.y()+4,option.rect.width()-8,option.rect.height()-8,pixmap);
+  // Rendered at exactly the size and pixel ratio it is shown at, so no scaling here.
+  // Until it is ready there is only the title.
+  const QRect thumbnailRect = option.rect.adjusted(4, 4, -4, -4);
+  const QPixmap pixmap = m_thumbnails->thumbnail(gameboardFile, thumbnailRect.size(), painter->device()->devicePixelRatioF());
+  if (!pixmap.isNull())
+    painter->drawPixmap(thumbnailRect.topLeft(), pixmap);
   QFont font = painter->font();
   font.setWeight(QFont::Bold);
 
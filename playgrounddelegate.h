@@ -22,13 +22,19 @@
 #include <QAbstractItemDelegate>
 #include <QAbstractItemView>
 
+class ThumbnailCache;
+
 class PlaygroundDelegate : public QAbstractItemDelegate
 {
   public:
-    explicit PlaygroundDelegate(QObject *parent = 0);
+    // The items hold the gameboard SVG in the given role, the thumbnails come from the cache
+    PlaygroundDelegate(ThumbnailCache *thumbnails, int gameboardFileRole, QObject *parent = 0);
   private:
     QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
     void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+    ThumbnailCache *m_thumbnails;
+    int m_gameboardFileRole;
 };
 
 #endif // PLAYGROUNDDELEGATE_H
@@ -0,0 +1,305 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Renders saved tuberlings for other processes, see --render-service */
+
+#include "renderservice.h"
+
+#include <algorithm>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFutureWatcher>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtConcurrentRun>
+
+#include "filefactory.h"
+#include "gameboard.h"
+#include "gameboardrepository.h"
+#include "instrumentation.h"
+#include "savegame.h"
+
+// Anything bigger is not a tuberling, the connection gets dropped
+static const qint64 maxRequestSize = 16 * 1024 * 1024;
+
+// Pictures are drawn in one piece
+static const int maxImageSide = 8192;
+
+// How many objects a saved tuberling may have
+static const int maxItems = 100000;
+
+// How many latencies the percentiles are taken from
+static const int latencyWindow = 1024;
+
+RenderService::RenderService(QObject *parent)
+ : QObject(parent), m_server(new QLocalServer(this)), m_playGround(new PlayGround(&m_callbacks)), m_renderScheduled(false),
+   m_encoding(0), m_maxQueueDepth(0), m_nextLatency(0), m_requests(0), m_rendered(0), m_failed(0)
+{
+  m_clock.start();
+  m_server->setSocketOptions(QLocalServer::UserAccessOption);
+  connect(m_server, &QLocalServer::newConnection, this, &RenderService::newConnection);
+}
+
+RenderService::~RenderService()
+{
+  delete m_playGround;
+}
+
+bool RenderService::listen(const QString &name)
+{
+  // left behind by a service that crashed
+  QLocalServer::removeServer(name);
+  return m_server->listen(name);
+}
+
+QString RenderService::errorString() const
+{
+  return m_server->errorString();
+}
+
+QVariantMap RenderService::statistics() const
+{
+  QVariantMap result;
+  result[QStringLiteral("queueDepth")] = m_queue.count();
+  result[QStringLiteral("maxQueueDepth")] = m_maxQueueDepth;
+  result[QStringLiteral("encoding")] = m_encoding;
+  result[QStringLiteral("requests")] = m_requests;
+  result[QStringLiteral("rendered")] = m_rendered;
+  result[QStringLiteral("failed")] = m_failed;
+
+  QVector<qint64> latencies = m_latencies;
+  std::sort(latencies.begin(), latencies.end());
+  QVariantMap latency;
+  latency[QStringLiteral("count")] = latencies.count();
+  if (!latencies.isEmpty())
+  {
+    qint64 total = 0;
+    for (qint64 value : latencies)
+      total += value;
+    latency[QStringLiteral("meanMs")] = total / 1e6 / latencies.count();
+    latency[QStringLiteral("p50Ms")] = latencies.at(latencies.count() / 2) / 1e6;
+    latency[QStringLiteral("p95Ms")] = latencies.at(latencies.count() * 95 / 100) / 1e6;
+    latency[QStringLiteral("maxMs")] = latencies.last() / 1e6;
+  }
+  result[QStringLiteral("latency")] = latency;
+  return result;
+}
+
+void RenderService::newConnection()
+{
+  while (QLocalSocket *socket = m_server->nextPendingConnection())
+  {
+    connect(socket, &QLocalSocket::readyRead, this, [this, socket] { readRequests(socket); });
+    connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    readRequests(socket);
+  }
+}
+
+// Several requests may have come at once, or only part of one
+void RenderService::readRequests(QLocalSocket *socket)
+{
+  QDataStream in(socket);
+  in.setVersion(QDataStream::Qt_5_9);
+  forever
+  {
+    if (socket->bytesAvailable() > maxRequestSize)
+    {
+      socket->abort();
+      return;
+    }
+
+    quint32 id;
+    QString command;
+    QByteArray payload;
+    QSize size;
+    in.startTransaction();
+    in >> id >> command >> payload >> size;
+    if (!in.commitTransaction())
+    {
+      // the rest is still on its way, unless it makes no sense
+      if (in.status() == QDataStream::ReadCorruptData) socket->abort();
+      return;
+    }
+
+    m_requests++;
+    const qint64 received = m_clock.nsecsElapsed();
+    if (command == QLatin1String("stats"))
+    {
+      reply(socket, id, Ok, QJsonDocument(QJsonObject::fromVariantMap(statistics())).toJson(QJsonDocument::Compact), -1);
+    }
+    else if (command == QLatin1String("render"))
+    {
+      if (size.width() > maxImageSide || size.height() > maxImageSide)
+      {
+        reply(socket, id, BadRequest, "Picture too big", received);
+        continue;
+      }
+      const Job job = { socket, id, payload, size, received };
+      m_queue.enqueue(job);
+      m_maxQueueDepth = qMax(m_maxQueueDepth, m_queue.count());
+      scheduleRender();
+    }
+    else
+    {
+      reply(socket, id, BadRequest, "Unknown command", received);
+    }
+  }
+}
+
+// received is -1 for what does not count as a render
+void RenderService::reply(QLocalSocket *socket, quint32 id, Status status, const QByteArray &data, qint64 received)
+{
+  if (received >= 0)
+  {
+    if (status == Ok) m_rendered++;
+    else m_failed++;
+    addLatency(m_clock.nsecsElapsed() - received);
+  }
+
+  // gone while waiting, nobody to tell
+  if (!socket || socket->state() != QLocalSocket::ConnectedState) return;
+
+  QDataStream out(socket);
+  out.setVersion(QDataStream::Qt_5_9);
+  out << id << quint8(status) << data;
+}
+
+void RenderService::addLatency(qint64 latency)
+{
+  if (m_latencies.count() < latencyWindow)
+  {
+    m_latencies << latency;
+  }
+  else
+  {
+    m_latencies[m_nextLatency] = latency;
+    m_nextLatency = (m_nextLatency + 1) % latencyWindow;
+  }
+}
+
+// One scene per event loop pass, so that requests keep being read
+void RenderService::scheduleRender()
+{
+  if (m_renderScheduled) return;
+  m_renderScheduled = true;
+  QTimer::singleShot(0, this, &RenderService::renderNext);
+}
+
+// The gameboard and every object have to exist before PlayGround::loadFrom()
+// gets the payload, it would add unknown objects to the gameboard catalog
+RenderService::Status RenderService::checkPayload(const QByteArray &payload, QSize *size, QSharedPointer<Gameboard> *gameboard, QString *error) const
+{
+  QByteArray data = payload;
+  QBuffer buffer(&data);
+  SaveGameReader reader;
+  if (reader.open(&buffer) != SaveGameReader::NoError)
+  {
+    *error = QStringLiteral("Not a saved tuberling");
+    return BadRequest;
+  }
+
+  const QString gameboardName = reader.gameboard();
+  const QString themeFile = gameboardName.contains(QLatin1Char('/')) || gameboardName.contains(QLatin1Char('\\'))
+                            ? QString() : FileFactory::locate(QLatin1String( "pics/" ) + gameboardName);
+  *gameboard = themeFile.isEmpty() ? QSharedPointer<Gameboard>() : GameboardRepository::self()->gameboard(themeFile);
+  if (!*gameboard)
+  {
+    *error = QStringLiteral("Unknown gameboard %1").arg(gameboardName);
+    return BadRequest;
+  }
+
+  int itemCount = 0;
+  SaveGameReader::Item item;
+  while (!reader.atEnd())
+  {
+    if (!reader.readItem(&item) || ++itemCount > maxItems)
+    {
+      *error = QStringLiteral("Not a saved tuberling");
+      return BadRequest;
+    }
+    if ((*gameboard)->findElement(item.element) == -1)
+    {
+      *error = QStringLiteral("Unknown object %1").arg(item.element);
+      return BadRequest;
+    }
+  }
+
+  if (size->isEmpty())
+    *size = (*gameboard)->backgroundRect().size().toSize();
+  return Ok;
+}
+
+void RenderService::renderNext()
+{
+  m_renderScheduled = false;
+  // drawn pictures waiting for an encoder only take memory
+  if (m_queue.isEmpty() || m_encoding >= QThreadPool::globalInstance()->maxThreadCount()) return;
+
+  Instrumentation::Scope scope("RenderService::renderNext");
+
+  Job job = m_queue.dequeue();
+  if (!m_queue.isEmpty()) scheduleRender();
+  if (!job.socket)
+  {
+    m_failed++;
+    return;
+  }
+
+  // held until the scene holds it
+  QSharedPointer<Gameboard> gameboard;
+  QString error;
+  const Status status = checkPayload(job.payload, &job.size, &gameboard, &error);
+  if (status != Ok)
+  {
+    reply(job.socket, job.id, status, error.toUtf8(), job.received);
+    return;
+  }
+
+  QBuffer buffer(&job.payload);
+  if (m_playGround->loadFrom(&buffer) != PlayGround::NoError)
+  {
+    if (!m_playGround->currentGameboard().isEmpty()) m_playGround->reset();
+    reply(job.socket, job.id, RenderError, "Could not load the tuberling", job.received);
+    return;
+  }
+  const QImage image = m_playGround->getImage(job.size);
+  // the objects go, the scene and its gameboard stay for the next request
+  m_playGround->reset();
+
+  m_encoding++;
+  QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
+  const QPointer<QLocalSocket> socket = job.socket;
+  const quint32 id = job.id;
+  const qint64 received = job.received;
+  connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher, socket, id, received]
+  {
+    m_encoding--;
+    const QByteArray data = watcher->result();
+    if (data.isEmpty())
+      reply(socket, id, RenderError, "Could not encode the picture", received);
+    else
+      reply(socket, id, Ok, data, received);
+    watcher->deleteLater();
+    scheduleRender();
+  });
+  watcher->setFuture(QtConcurrent::run([image]
+  {
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "png"))
+      data.clear();
+    return data;
+  }));
+}
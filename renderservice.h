@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Renders saved tuberlings for other processes, see --render-service */
+
+#ifndef RENDERSERVICE_H
+#define RENDERSERVICE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QSize>
+#include <QVariantMap>
+#include <QVector>
+
+#include "headlesscallbacks.h"
+#include "playground.h"
+
+class Gameboard;
+class QLocalServer;
+class QLocalSocket;
+
+// Messages both ways are QDataStream (Qt_5_9) records:
+//
+//   request  quint32 id, QString command, QByteArray payload, QSize size
+//   reply    quint32 id, quint8 status, QByteArray data
+//
+// "render" takes a saved tuberling as payload and replies with a PNG of
+// it, at size or at the size of the gameboard when size is empty.
+// "stats" replies with the queue depth and latencies as JSON. Replies
+// may come in another order than the requests, the id tells them apart.
+//
+// Scenes can only be drawn in the GUI thread, so they are drawn one
+// after the other by a play ground nobody sees, whose scene cache keeps
+// the gameboards warm. Encoding the PNGs happens in the thread pool
+// meanwhile.
+class RenderService : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum Status { Ok = 0, BadRequest, RenderError };
+
+    explicit RenderService(QObject *parent = nullptr);
+    ~RenderService();
+
+    // Only the user running the service may connect
+    bool listen(const QString &name);
+    QString errorString() const;
+
+    QVariantMap statistics() const;
+
+  private:
+    struct Job
+    {
+      QPointer<QLocalSocket> socket;
+      quint32 id;
+      QByteArray payload;
+      QSize size;
+      qint64 received;				// on m_clock, ns
+    };
+
+    void newConnection();
+    void readRequests(QLocalSocket *socket);
+    void reply(QLocalSocket *socket, quint32 id, Status status, const QByteArray &data, qint64 received);
+    void scheduleRender();
+    void renderNext();
+    Status checkPayload(const QByteArray &payload, QSize *size, QSharedPointer<Gameboard> *gameboard, QString *error) const;
+    void addLatency(qint64 latency);
+
+    QLocalServer *m_server;
+    HeadlessCallbacks m_callbacks;
+    PlayGround *m_playGround;			// never shown
+    QQueue<Job> m_queue;			// waiting to be drawn
+    bool m_renderScheduled;
+    int m_encoding;				// drawn, their PNGs being written
+    int m_maxQueueDepth;
+
+    QElapsedTimer m_clock;
+    QVector<qint64> m_latencies;		// the last ones, from request to reply (ns)
+    int m_nextLatency;
+    qint64 m_requests;
+    qint64 m_rendered;
+    qint64 m_failed;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Reading saved tuberlings, for the game and the thumbnailer */
+
+#include "savegame.h"
+
+#include <QIODevice>
+
+static const char *saveGameTextScaleTextMode = "KTuberlingSaveGameV2";
+static const char *saveGameTextTextMode = "KTuberlingSaveGameV3";
+const char saveGameText[] = "KTuberlingSaveGameV4";
+
+SaveGameReader::SaveGameReader()
+ : m_needsScaling(false)
+{
+}
+
+SaveGameReader::Error SaveGameReader::open(QIODevice *device)
+{
+  if (!device->open(QIODevice::ReadOnly))
+      return OtherError;
+
+  m_stream.setDevice(device);
+  m_stream.setVersion(QDataStream::Qt_4_5);
+
+  bool reopenInTextMode = false;
+  QString magicText;
+  m_stream >> magicText;
+  if ( QLatin1String( saveGameTextScaleTextMode ) == magicText) {
+      m_needsScaling = true;
+      reopenInTextMode = true;
+  } else if (QLatin1String( saveGameTextTextMode ) == magicText) {
+      reopenInTextMode = true;
+  } else if ( QLatin1String( saveGameText ) != magicText) {
+      return OldFileVersionError;
+  }
+
+  if (reopenInTextMode) {
+      device->close();
+      if (!device->open(QIODevice::ReadOnly | QIODevice::Text))
+        return OtherError;
+      m_stream.setDevice(device);
+      m_stream.setVersion(QDataStream::Qt_4_5);
+      m_stream >> magicText;
+  }
+
+  if (m_stream.atEnd())
+    return OtherError;
+
+  m_stream >> m_gameboard;
+  return m_stream.status() == QDataStream::Ok ? NoError : OtherError;
+}
+
+QString SaveGameReader::gameboard() const
+{
+  return m_gameboard;
+}
+
+bool SaveGameReader::needsScaling() const
+{
+  return m_needsScaling;
+}
+
+bool SaveGameReader::atEnd() const
+{
+  return m_stream.atEnd();
+}
+
+bool SaveGameReader::readItem(Item *item)
+{
+  m_stream >> item->pos;
+  m_stream >> item->element;
+  m_stream >> item->z;
+  return m_stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Reading saved tuberlings, for the game and the thumbnailer */
+
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <QDataStream>
+#include <QPointF>
+#include <QString>
+
+class QIODevice;
+
+// What saved files start with nowadays, older ones can still be read
+extern const char saveGameText[];
+
+// Only the file format, nothing about gameboards or scenes
+class SaveGameReader
+{
+  public:
+    enum Error { NoError, OldFileVersionError, OtherError };
+
+    struct Item
+    {
+      QPointF pos;
+      QString element;
+      qreal z;
+    };
+
+    SaveGameReader();
+
+    // Opens the device, which must not be open yet, and reads up to the items
+    Error open(QIODevice *device);
+
+    // The file name of the theme, without directory
+    QString gameboard() const;
+    // Positions in the oldest files depend on the window size when saving
+    bool needsScaling() const;
+
+    bool atEnd() const;
+    bool readItem(Item *item);
+
+  private:
+    QDataStream m_stream;
+    QString m_gameboard;
+    bool m_needsScaling;
+};
+
+#endif
@@ -22,12 +22,25 @@
 #include <QUrl>
 
 #include "filefactory.h"
+#include "gameboard.h"
+#include "performancecounters.h"
 
 // Constructor
 SoundFactory::SoundFactory(SoundFactoryCallbacks *callbacks)
- : m_callbacks(callbacks)
+ : m_callbacks(callbacks), language(-1)
 {
   player = new QMediaPlayer();
+
+  // The latency is from asking for a sound until it is ready to be heard
+  QObject::connect(player, &QMediaPlayer::mediaStatusChanged, player, [this](QMediaPlayer::MediaStatus status)
+  {
+    if (!soundRequest.isValid()) return;
+
+    if (status == QMediaPlayer::BufferedMedia)
+      PerformanceCounters::self()->addSoundStartLatency(soundRequest.elapsed());
+    if (status == QMediaPlayer::BufferedMedia || status == QMediaPlayer::InvalidMedia)
+      soundRequest.invalidate();
+  });
 }
 
 // Destructor
@@ -37,18 +50,27 @@ SoundFactory::~SoundFactory()
 }
 
 // Play some sound
-void SoundFactory::playSound(const QString &soundRef) const
+void SoundFactory::playSound(Gameboard *gameboard, int sound) const
 {
   if (!m_callbacks->isSoundEnabled()) return;
 
-  int sound;
-  for (sound = 0; sound < sounds; sound++)
-	  if (!namesList[sound].compare(soundRef)) break;
-  if (sound == sounds) return;
+  // a reloaded theme may have brought new sounds
+  if (gameboard->soundLanguage() != language || sound >= gameboard->soundFiles().count())
+  {
+    QVector<QString> files(gameboard->soundCount());
+    for (int i = 0; i < files.count(); ++i)
+    {
+      const QString file = soundFiles.value(gameboard->soundName(i));
+      if (!file.isEmpty())
+        files[i] = FileFactory::locate(QLatin1String( "sounds/" ) + file);
+    }
+    gameboard->setSoundFiles(language, files);
+  }
 
-  const QString soundFile = FileFactory::locate(QLatin1String( "sounds/" ) + filesList[sound]);
+  const QString soundFile = gameboard->soundFiles().value(sound);
   if (soundFile.isEmpty()) return;
 
+  soundRequest.start();
   player->setMedia(QUrl::fromLocalFile(soundFile));
   player->play();
 }
@@ -101,24 +123,28 @@ bool SoundFactory::loadLanguage(const QString &selectedLanguageFile)
   languageElement = document.documentElement();
 
   soundNamesList = languageElement.elementsByTagName(QStringLiteral( "sound" ));
-  sounds = soundNamesList.count();
+  const int sounds = soundNamesList.count();
   if (sounds < 1)
     return false;
 
 
-  namesList.clear();
-  filesList.clear();
+  soundFiles.clear();
+  soundFiles.reserve(sounds);
   for (int sound = 0; sound < sounds; sound++)
   {
     soundNameElement = (const QDomElement &) soundNamesList.item(sound).toElement();
 
     nameAttribute = soundNameElement.attributeNode(QStringLiteral( "name" ));
-    namesList << nameAttribute.value();
     fileAttribute = soundNameElement.attributeNode(QStringLiteral( "file" ));
-    filesList << fileAttribute.value();
+    // the first one wins, as when they were searched in order
+    if (!soundFiles.contains(nameAttribute.value()))
+      soundFiles.insert(nameAttribute.value(), fileAttribute.value());
   }
 
   currentSndFile = selectedLanguageFile;
+  // however many sound factories there are
+  static int lastLanguage = -1;
+  language = ++lastLanguage;
 
   return true;
 }
@@ -13,8 +13,11 @@
 #ifndef _SOUNDFACTORY_H_
 #define _SOUNDFACTORY_H_
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QStringList>
 
+class Gameboard;
 class QMediaPlayer;
 
 class SoundFactoryCallbacks
@@ -32,7 +35,8 @@ public:
   ~SoundFactory();
 
   bool loadLanguage(const QString &selectedLanguageFile);
-  void playSound(const QString &soundRef) const;
+  // The files of the sounds of a gameboard are looked for once per language
+  void playSound(Gameboard *gameboard, int sound) const;
 
   QString currentSoundFile() const;
 
@@ -42,12 +46,12 @@ private:
   SoundFactoryCallbacks *m_callbacks;
 
   QString currentSndFile;		// The current language
+  int language;				// different for every language loaded, see Gameboard::soundLanguage()
 
-  int sounds;				// Number of sounds
-  QStringList namesList,		// List of sound names
-              filesList;           // List of sound files associated with each sound name
+  QHash<QString, QString> soundFiles;	// sound name -> sound file
 
   QMediaPlayer *player;
+  mutable QElapsedTimer soundRequest;	// since the last sound was asked for
 };
 
 #endif
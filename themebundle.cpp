@@ -0,0 +1,199 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* A whole theme in one file, read through a memory map */
+
+#include "themebundle.h"
+
+#include <cstring>
+
+#include <QSaveFile>
+#include <QtEndian>
+
+static const char bundleMagic[8] = { 'K', 'T', 'B', 'U', 'N', 'D', 'L', 'E' };
+static const quint32 bundleVersion = 1;
+static const int headerSize = 16;
+static const int sectionSize = 40;
+static const int alignment = 16;
+
+static qint64 aligned(qint64 offset)
+{
+  return (offset + alignment - 1) & ~qint64(alignment - 1);
+}
+
+ThemeBundle::ThemeBundle()
+{
+}
+
+bool ThemeBundle::open(const QString &fileName)
+{
+  m_file.setFileName(fileName);
+  if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+  const qint64 size = m_file.size();
+  if (size < headerSize) return false;
+  const uchar *map = m_file.map(0, size);
+  if (!map) return false;
+
+  if (memcmp(map, bundleMagic, sizeof(bundleMagic)) != 0) return false;
+  if (qFromLittleEndian<quint32>(map + 8) != bundleVersion) return false;
+  const quint32 count = qFromLittleEndian<quint32>(map + 12);
+  if (count > quint64(size - headerSize) / sectionSize) return false;
+
+  for (quint32 i = 0; i < count; ++i)
+  {
+    const uchar *record = map + headerSize + i * sectionSize;
+    const quint32 kind = qFromLittleEndian<quint32>(record);
+    const quint32 width = qFromLittleEndian<quint32>(record + 4);
+    const quint32 height = qFromLittleEndian<quint32>(record + 8);
+    const quint32 nameSize = qFromLittleEndian<quint32>(record + 12);
+    const quint64 nameOffset = qFromLittleEndian<quint64>(record + 16);
+    const quint64 dataOffset = qFromLittleEndian<quint64>(record + 24);
+    const quint64 dataSize = qFromLittleEndian<quint64>(record + 32);
+
+    // a truncated or corrupt bundle is no bundle at all
+    if (nameOffset > quint64(size) || nameSize > quint64(size) - nameOffset) return false;
+    if (dataOffset > quint64(size) || dataSize > quint64(size) - dataOffset) return false;
+    if (kind < ThemeKind || kind > ThumbnailKind) continue;
+
+    Section section;
+    section.kind = Kind(kind);
+    section.size = QSize(int(width), int(height));
+    section.data = map + dataOffset;
+    section.dataSize = qint64(dataSize);
+    if (section.kind == ThumbnailKind)
+    {
+      if (width > 0x7fff || height > 0x7fff || dataSize != quint64(width) * height * 4 || dataOffset % 4) return false;
+    }
+
+    m_sections << section;
+  }
+  return true;
+}
+
+QString ThemeBundle::fileName() const
+{
+  return m_file.fileName();
+}
+
+QByteArray ThemeBundle::data(Kind kind) const
+{
+  for (const Section &section : m_sections)
+  {
+    if (section.kind == kind)
+      return QByteArray::fromRawData(reinterpret_cast<const char *>(section.data), int(section.dataSize));
+  }
+  return QByteArray();
+}
+
+QByteArray ThemeBundle::theme() const
+{
+  return data(ThemeKind);
+}
+
+QByteArray ThemeBundle::desktop() const
+{
+  return data(DesktopKind);
+}
+
+QByteArray ThemeBundle::svg() const
+{
+  return data(SvgKind);
+}
+
+// Read only, painting on it makes a copy
+QImage ThemeBundle::image(const Section &section) const
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+  // the pixels are little endian words, nothing to gain from them here
+  Q_UNUSED(section);
+  return QImage();
+#else
+  return QImage(section.data, section.size.width(), section.size.height(), section.size.width() * 4, QImage::Format_ARGB32_Premultiplied);
+#endif
+}
+
+QImage ThemeBundle::thumbnail() const
+{
+  for (const Section &section : m_sections)
+  {
+    if (section.kind == ThumbnailKind)
+      return image(section);
+  }
+  return QImage();
+}
+
+void ThemeBundleWriter::add(ThemeBundle::Kind kind, const QByteArray &data)
+{
+  Section section;
+  section.kind = kind;
+  section.data = data;
+  m_sections << section;
+}
+
+void ThemeBundleWriter::addImage(ThemeBundle::Kind kind, const QImage &image)
+{
+  const QImage converted = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  Section section;
+  section.kind = kind;
+  section.size = converted.size();
+  section.data.resize(converted.width() * converted.height() * 4);
+  uchar *out = reinterpret_cast<uchar *>(section.data.data());
+  for (int y = 0; y < converted.height(); ++y)
+  {
+    const quint32 *row = reinterpret_cast<const quint32 *>(converted.constScanLine(y));
+    for (int x = 0; x < converted.width(); ++x, out += 4)
+      qToLittleEndian<quint32>(row[x], out);
+  }
+  m_sections << section;
+}
+
+bool ThemeBundleWriter::write(const QString &fileName) const
+{
+  QByteArray index(headerSize + m_sections.count() * sectionSize, 0);
+  uchar *out = reinterpret_cast<uchar *>(index.data());
+  memcpy(out, bundleMagic, sizeof(bundleMagic));
+  qToLittleEndian<quint32>(bundleVersion, out + 8);
+  qToLittleEndian<quint32>(quint32(m_sections.count()), out + 12);
+
+  // names and data follow the index, each on its own boundary
+  qint64 offset = aligned(index.size());
+  for (int i = 0; i < m_sections.count(); ++i)
+  {
+    const Section &section = m_sections.at(i);
+    uchar *record = out + headerSize + i * sectionSize;
+    const qint64 nameOffset = offset;
+    offset = aligned(offset + section.name.size());
+    const qint64 dataOffset = offset;
+    offset = aligned(offset + section.data.size());
+
+    qToLittleEndian<quint32>(section.kind, record);
+    qToLittleEndian<quint32>(quint32(section.size.width()), record + 4);
+    qToLittleEndian<quint32>(quint32(section.size.height()), record + 8);
+    qToLittleEndian<quint32>(quint32(section.name.size()), record + 12);
+    qToLittleEndian<quint64>(quint64(nameOffset), record + 16);
+    qToLittleEndian<quint64>(quint64(dataOffset), record + 24);
+    qToLittleEndian<quint64>(quint64(section.data.size()), record + 32);
+  }
+
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+
+  const QByteArray padding(alignment, 0);
+  file.write(index);
+  file.write(padding.constData(), aligned(index.size()) - index.size());
+  for (const Section &section : m_sections)
+  {
+    file.write(section.name);
+    file.write(padding.constData(), aligned(section.name.size()) - section.name.size());
+    file.write(section.data);
+    file.write(padding.constData(), aligned(section.data.size()) - section.data.size());
+  }
+  return file.commit();
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* A whole theme in one file, read through a memory map */
+
+#ifndef THEMEBUNDLE_H
+#define THEMEBUNDLE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QVector>
+
+// The .theme and .desktop files as they are, the SVG uncompressed and a
+// thumbnail of the background, written by ktuberling_bundle when
+// installing. Everything is little
+// endian and 16 byte aligned:
+//
+//   header   "KTBUNDLE", quint32 version, quint32 section count
+//   sections quint32 kind, quint32 width, quint32 height, quint32 name size,
+//            quint64 name offset, quint64 data offset, quint64 data size
+//   then the names (UTF-8, empty so far) and the data
+//
+// Images are premultiplied ARGB32 rows without padding.
+class ThemeBundle
+{
+  public:
+    enum Kind { ThemeKind = 1, DesktopKind, SvgKind, ThumbnailKind };
+
+    ThemeBundle();
+
+    bool open(const QString &fileName);
+    QString fileName() const;
+
+    // No copies, these point into the map and are only valid as long as the bundle lives
+    QByteArray theme() const;
+    QByteArray desktop() const;
+    QByteArray svg() const;
+    QImage thumbnail() const;
+
+  private:
+    struct Section
+    {
+      Kind kind;
+      QSize size;
+      const uchar *data;
+      qint64 dataSize;
+    };
+
+    QByteArray data(Kind kind) const;
+    QImage image(const Section &section) const;
+
+    QFile m_file;
+    QVector<Section> m_sections;
+};
+
+class ThemeBundleWriter
+{
+  public:
+    void add(ThemeBundle::Kind kind, const QByteArray &data);
+    void addImage(ThemeBundle::Kind kind, const QImage &image);
+    bool write(const QString &fileName) const;
+
+  private:
+    struct Section
+    {
+      ThemeBundle::Kind kind;
+      QSize size;
+      QByteArray name;
+      QByteArray data;
+    };
+    QVector<Section> m_sections;
+};
+
+#endif
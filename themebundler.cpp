@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Turns a directory of themes into theme bundles, when installing */
+
+#include <KCompressionDevice>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QTextStream>
+
+#include "themebundle.h"
+
+static QByteArray readFile(const QString &fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+  return file.readAll();
+}
+
+// Plain SVG as it is, SVGZ unpacked so that loading it is only parsing
+static QByteArray readSvg(const QString &fileName)
+{
+  if (!fileName.endsWith(QLatin1String(".svgz")))
+    return readFile(fileName);
+
+  KCompressionDevice device(fileName, KCompressionDevice::GZip);
+  if (!device.open(QIODevice::ReadOnly)) return QByteArray();
+  return device.readAll();
+}
+
+static QImage renderElement(QSvgRenderer *renderer, const QString &elementId, const QSize &size)
+{
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  renderer->render(&painter, elementId);
+  painter.end();
+  return image;
+}
+
+static bool bundleTheme(const QString &themeFile, const QString &outputDir, int thumbnailWidth)
+{
+  QTextStream err(stderr);
+  const QString dir = QFileInfo(themeFile).path();
+
+  const QByteArray theme = readFile(themeFile);
+  QDomDocument document;
+  if (!document.setContent(theme))
+  {
+    err << themeFile << ": not a theme\n";
+    return false;
+  }
+  const QDomElement playGround = document.documentElement();
+
+  const QByteArray desktop = readFile(dir + QLatin1Char('/') + playGround.attribute(QStringLiteral( "desktop" )));
+  const QByteArray svg = readSvg(dir + QLatin1Char('/') + playGround.attribute(QStringLiteral( "gameboard" )));
+  QSvgRenderer renderer(svg);
+  if (desktop.isEmpty() || !renderer.isValid())
+  {
+    err << themeFile << ": desktop file or gameboard missing\n";
+    return false;
+  }
+
+  ThemeBundleWriter writer;
+  writer.add(ThemeBundle::ThemeKind, theme);
+  writer.add(ThemeBundle::DesktopKind, desktop);
+  writer.add(ThemeBundle::SvgKind, svg);
+
+  // the same picture the theme chooser shows, ThumbnailCache scales it down
+  const QSizeF background = renderer.boundsOnElement(QStringLiteral( "background" )).size();
+  if (thumbnailWidth > 0 && !background.isEmpty())
+  {
+    const QSize size(thumbnailWidth, qMax(1, qRound(thumbnailWidth * background.height() / background.width())));
+    writer.addImage(ThemeBundle::ThumbnailKind, renderElement(&renderer, QStringLiteral( "background" ), size));
+  }
+
+  const QString bundleFile = outputDir + QLatin1Char('/') + QFileInfo(themeFile).completeBaseName() + QStringLiteral(".ktbundle");
+  if (!writer.write(bundleFile))
+  {
+    err << bundleFile << ": cannot be written\n";
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  // rendering needs a GUI application, but not a display
+  qputenv("QT_QPA_PLATFORM", "offscreen");
+  QGuiApplication app(argc, argv);
+  app.setApplicationName(QStringLiteral("ktuberling_bundle"));
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(QStringLiteral("Writes a .ktbundle file for every theme of a directory"));
+  parser.addHelpOption();
+  QCommandLineOption thumbnailOption(QStringLiteral("thumbnail-width"), QStringLiteral("Width of the thumbnails, 0 for none."), QStringLiteral("pixels"), QStringLiteral("256"));
+  parser.addOption(thumbnailOption);
+  parser.addPositionalArgument(QStringLiteral("themes"), QStringLiteral("Directory with the .theme files"));
+  parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("Directory to write the bundles to"));
+  parser.process(app);
+
+  const QStringList args = parser.positionalArguments();
+  if (args.count() != 2)
+    parser.showHelp(1);
+
+
+  QDir().mkpath(args.at(1));
+  const QDir themesDir(args.at(0));
+  bool ok = true;
+  foreach (const QString &file, themesDir.entryList(QStringList() << QStringLiteral("*.theme")))
+    ok = bundleTheme(themesDir.filePath(file), args.at(1), parser.value(thumbnailOption).toInt()) && ok;
+  return ok ? 0 : 1;
+}
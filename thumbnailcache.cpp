@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Gameboard thumbnails, rendered on demand and kept in memory and on disk */
+
+#include "thumbnailcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QSvgRenderer>
+#include <QtConcurrentRun>
+
+#include "gameboardrepository.h"
+#include "themebundle.h"
+
+// What the thumbnails may take in memory, in kilobytes
+static const int maxMemoryCost = 32 * 1024;
+
+static QImage loadOrRender(const QString &gameboardFile, const QSharedPointer<ThemeBundle> &bundle, const QSize &deviceSize, const QString &cacheFile)
+{
+  QImage image;
+  if (image.load(cacheFile, "PNG") && image.size() == deviceSize)
+    return image;
+
+  // bundles come with a thumbnail, scaling it down is cheaper than rendering
+  const QImage bundled = bundle ? bundle->thumbnail() : QImage();
+  if (!bundled.isNull() && bundled.width() >= deviceSize.width() && bundled.height() >= deviceSize.height())
+  {
+    image = bundled.scaled(deviceSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  }
+  else
+  {
+    // renderers cannot be shared between threads
+    QSvgRenderer renderer;
+    if (bundle) renderer.load(bundle->svg());
+    else renderer.load(gameboardFile);
+    image = QImage(deviceSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    renderer.render(&painter, QStringLiteral( "background" ));
+    painter.end();
+  }
+
+  // best effort, next time it is only a PNG to read
+  QDir().mkpath(QFileInfo(cacheFile).path());
+  image.save(cacheFile, "PNG");
+  return image;
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+ : QObject(parent)
+{
+  m_pixmaps.setMaxCost(maxMemoryCost);
+  MemoryBudget::self()->registerCache("thumbnails", MemoryBudget::ReadFromDisk, this);
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+  MemoryBudget::self()->unregisterCache(this);
+}
+
+qint64 ThumbnailCache::memoryUsed() const
+{
+  return qint64(m_pixmaps.totalCost()) * 1024;
+}
+
+// Lowering the maximum cost drops the least recently used ones
+qint64 ThumbnailCache::evict(qint64 bytes)
+{
+  const int before = m_pixmaps.totalCost();
+  m_pixmaps.setMaxCost(qMax(qint64(0), before - (bytes + 1023) / 1024));
+  m_pixmaps.setMaxCost(maxMemoryCost);
+  return qint64(before - m_pixmaps.totalCost()) * 1024;
+}
+
+// Changing the SVG gives another key, stale files are simply not used any more.
+// Views ask on every paint, the file is only looked at until invalidate().
+QString ThumbnailCache::key(const QString &gameboardFile, const QSize &deviceSize)
+{
+  QHash<quint64, QString> &keys = m_fileKeys[gameboardFile];
+  const quint64 sizeKey = (quint64(quint32(deviceSize.width())) << 32) | quint32(deviceSize.height());
+  QHash<quint64, QString>::const_iterator it = keys.constFind(sizeKey);
+  if (it != keys.constEnd())
+    return it.value();
+
+  const QString id = gameboardFile + QLatin1Char('@') + QString::number(QFileInfo(gameboardFile).lastModified().toMSecsSinceEpoch())
+                   + QLatin1Char('@') + QString::number(deviceSize.width()) + QLatin1Char('x') + QString::number(deviceSize.height());
+  const QString key = QString::fromLatin1(QCryptographicHash::hash(id.toUtf8(), QCryptographicHash::Md5).toHex());
+  keys.insert(sizeKey, key);
+  return key;
+}
+
+void ThumbnailCache::invalidate(const QString &gameboardFile)
+{
+  // a changed SVG gives other keys anyway, the old pixmaps only take memory
+  foreach (const QString &key, m_keys.take(gameboardFile))
+    m_pixmaps.remove(key);
+  m_fileKeys.remove(gameboardFile);
+  emit thumbnailReady(gameboardFile);
+}
+
+QPixmap ThumbnailCache::thumbnail(const QString &gameboardFile, const QSize &size, qreal devicePixelRatio)
+{
+  const QSize deviceSize = size * devicePixelRatio;
+  const QString key = this->key(gameboardFile, deviceSize);
+
+  if (QPixmap *pixmap = m_pixmaps.object(key))
+    return *pixmap;
+
+  if (!m_pending.contains(key))
+  {
+    m_pending << key;
+
+    const QString cacheFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/thumbnails/") + key + QStringLiteral(".png");
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, gameboardFile, devicePixelRatio]
+    {
+      watcher->deleteLater();
+      m_pending.remove(key);
+
+      QPixmap *pixmap = new QPixmap(QPixmap::fromImage(watcher->result()));
+      pixmap->setDevicePixelRatio(devicePixelRatio);
+      m_pixmaps.insert(key, pixmap, qMax(1, pixmap->width() * pixmap->height() * 4 / 1024));
+      m_keys[gameboardFile] << key;
+      MemoryBudget::self()->checkBudget();
+      emit thumbnailReady(gameboardFile);
+    });
+    watcher->setFuture(QtConcurrent::run(loadOrRender, gameboardFile, GameboardRepository::self()->bundle(gameboardFile), deviceSize, cacheFile));
+  }
+
+  return QPixmap();
+}
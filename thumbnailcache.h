@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Gameboard thumbnails, rendered on demand and kept in memory and on disk */
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+
+#include "memorybudget.h"
+
+class ThumbnailCache : public QObject, public MemoryBudget::Cache
+{
+  Q_OBJECT
+
+  public:
+    explicit ThumbnailCache(QObject *parent = nullptr);
+    ~ThumbnailCache();
+
+    // The background of the gameboard SVG at size (in device independent
+    // pixels) for the given device pixel ratio. A null pixmap when it is
+    // not ready yet, thumbnailReady() tells when it is.
+    QPixmap thumbnail(const QString &gameboardFile, const QSize &size, qreal devicePixelRatio = 1);
+
+    // The gameboard changed, its thumbnails get rendered again when next asked for
+    void invalidate(const QString &gameboardFile);
+
+    // The ones in memory, those on disk are there to get them back
+    qint64 memoryUsed() const override;
+    qint64 evict(qint64 bytes) override;
+
+  Q_SIGNALS:
+    void thumbnailReady(const QString &gameboardFile);
+
+  private:
+    QString key(const QString &gameboardFile, const QSize &deviceSize);
+
+    QCache<QString, QPixmap> m_pixmaps;	// cost in kilobytes
+    QSet<QString> m_pending;			// keys being loaded or rendered
+    QHash<QString, QSet<QString>> m_keys;	// gameboard file -> keys it was cached under
+    QHash<QString, QHash<quint64, QString>> m_fileKeys;	// gameboard file -> device size -> its key, see key()
+};
+
+#endif
@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* How a tuberling was built, one picture per step of its history */
+
+#include "timelapse.h"
+
+#include <QFutureWatcher>
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include "action.h"
+#include "backgrounditem.h"
+#include "gameboard.h"
+#include "instrumentation.h"
+#include "todraw.h"
+
+// How long to wait for the background to be rendered at the size of the pictures
+static const int backgroundWait = 20;
+
+TimeLapse::TimeLapse(const QSharedPointer<Gameboard> &gameboard, const QRectF &background, const QSize &size, QObject *parent)
+ : QObject(parent), m_gameboard(gameboard), m_scene(new QGraphicsScene(QRectF(QPointF(0, 0), gameboard->defaultSize()))),
+   m_background(background), m_image(size, QImage::Format_ARGB32_Premultiplied), m_nextStep(-1), m_drawn(0), m_written(0),
+   m_encoding(0), m_ok(true), m_canceled(false), m_finished(false)
+{
+  m_scene->addItem(new BackgroundItem(gameboard.data()));
+  m_drawTimer.setSingleShot(true);
+  connect(&m_drawTimer, &QTimer::timeout, this, &TimeLapse::drawNext);
+}
+
+// The steps own the items out of the scene, the scene the others
+TimeLapse::~TimeLapse()
+{
+  qDeleteAll(m_steps);
+  delete m_scene;
+}
+
+QGraphicsScene *TimeLapse::scene() const
+{
+  return m_scene;
+}
+
+void TimeLapse::addStep(Action *action)
+{
+  m_steps << action;
+}
+
+int TimeLapse::frameCount() const
+{
+  return m_steps.count() + 1;
+}
+
+void TimeLapse::save(const QString &dir, const QString &baseName)
+{
+  m_dir = dir;
+  m_baseName = baseName;
+
+  // back to the start, on the copy only
+  for (int step = m_steps.count() - 1; step >= 0; --step)
+    m_steps.at(step)->undo();
+  m_drawTimer.start(0);
+}
+
+void TimeLapse::cancel()
+{
+  m_canceled = true;
+  m_ok = false;
+  m_drawTimer.stop();
+  if (m_encoding == 0) finish();
+}
+
+void TimeLapse::drawNext()
+{
+  if (m_canceled) return;
+  // every frame waiting for its encoder is a whole picture, keep few of them around
+  if (m_encoding >= qMax(2, QThread::idealThreadCount())) return;
+
+  Instrumentation::Scope scope("TimeLapse::drawNext");
+
+  if (m_nextStep < 0)
+  {
+    m_image.fill(Qt::transparent);
+    QPainter artist(&m_image);
+    m_scene->render(&artist, QRectF(m_image.rect()), m_background, Qt::IgnoreAspectRatio);
+    artist.end();
+    // the first time, the background may have been a stand in for the level that size needs
+    if (!m_gameboard->pendingBackgroundLevels().isEmpty())
+    {
+      m_drawTimer.start(backgroundWait);
+      return;
+    }
+    m_nextStep = 0;
+  }
+  else
+  {
+    ToDraw *item = m_steps.at(m_nextStep)->item();
+    QRectF changed = item->scene() ? item->sceneBoundingRect() : QRectF();
+    m_steps.at(m_nextStep)->redo();
+    if (item->scene()) changed |= item->sceneBoundingRect();
+    m_nextStep++;
+
+    // whole pixels, with the part of the scene that maps exactly to them
+    const qreal xScale = m_image.width() / m_background.width();
+    const qreal yScale = m_image.height() / m_background.height();
+    const QRect target = QRectF((changed.left() - m_background.left()) * xScale, (changed.top() - m_background.top()) * yScale,
+                                changed.width() * xScale, changed.height() * yScale).toAlignedRect() & m_image.rect();
+    if (!target.isEmpty())
+    {
+      const QRectF source(m_background.left() + target.left() / xScale, m_background.top() + target.top() / yScale,
+                          target.width() / xScale, target.height() / yScale);
+      QPainter artist(&m_image);
+      artist.setCompositionMode(QPainter::CompositionMode_Source);
+      artist.fillRect(target, Qt::transparent);
+      artist.setCompositionMode(QPainter::CompositionMode_SourceOver);
+      artist.setClipRect(target);
+      m_scene->render(&artist, QRectF(target), source, Qt::IgnoreAspectRatio);
+      artist.end();
+    }
+  }
+
+  encode();
+  if (m_nextStep < m_steps.count()) m_drawTimer.start(0);
+}
+
+// The encoder gets its own copy of the picture, the next frame detaches it
+void TimeLapse::encode()
+{
+  const QImage frame = m_image;
+  const QString fileName = QStringLiteral("%1/%2-%3.png").arg(m_dir, m_baseName).arg(++m_drawn, 4, 10, QLatin1Char('0'));
+
+  m_encoding++;
+  QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+  connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher]
+  {
+    m_encoding--;
+    m_ok = watcher->result() && m_ok;
+    watcher->deleteLater();
+    emit progress(++m_written);
+
+    if (m_canceled || m_written == frameCount())
+    {
+      if (m_encoding == 0) finish();
+    }
+    else if (!m_drawTimer.isActive() && m_nextStep < m_steps.count())
+    {
+      // it was waiting for an encoder
+      m_drawTimer.start(0);
+    }
+  });
+  watcher->setFuture(QtConcurrent::run([frame, fileName]
+  {
+    return frame.save(fileName, "png");
+  }));
+}
+
+void TimeLapse::finish()
+{
+  if (m_finished) return;
+  m_finished = true;
+  emit finished(m_ok);
+}
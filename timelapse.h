@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* How a tuberling was built, one picture per step of its history */
+
+#ifndef TIMELAPSE_H
+#define TIMELAPSE_H
+
+#include <QImage>
+#include <QObject>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+
+class Action;
+class Gameboard;
+class QGraphicsScene;
+
+// Works on a copy of the board and of its history, see PlayGround::timeLapse(),
+// so the document can go on being edited, or be closed, meanwhile. One step
+// is replayed per pass of the event loop, drawing again only what it
+// changed, and the pictures are encoded in the thread pool.
+class TimeLapse : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // size is the one of the pictures
+    TimeLapse(const QSharedPointer<Gameboard> &gameboard, const QRectF &background, const QSize &size, QObject *parent = nullptr);
+    ~TimeLapse();
+
+    // The copy of the board as it is now, to be filled by whoever copies it
+    QGraphicsScene *scene() const;
+    // The steps that led to it, oldest first, acting on the items of scene()
+    void addStep(Action *action);
+
+    // The board before the first step, and after each one
+    int frameCount() const;
+
+    // Writes dir/baseName-0001.png and on, progress() tells how many are written
+    void save(const QString &dir, const QString &baseName);
+
+  public Q_SLOTS:
+    // No more frames get drawn, finished() comes once the ones being encoded are
+    void cancel();
+
+  Q_SIGNALS:
+    void progress(int frames);
+    // ok is false when a picture could not be written, or after cancel()
+    void finished(bool ok);
+
+  private:
+    void drawNext();
+    void encode();
+    void finish();
+
+    QSharedPointer<Gameboard> m_gameboard;	// the items only have a pointer to it
+    QGraphicsScene *m_scene;
+    QVector<Action *> m_steps;
+    QRectF m_background;
+    QImage m_image;				// the frame being drawn
+    QTimer m_drawTimer;
+
+    QString m_dir;
+    QString m_baseName;
+    int m_nextStep;				// -1 until the first frame is drawn
+    int m_drawn;
+    int m_written;
+    int m_encoding;
+    bool m_ok;
+    bool m_canceled;
+    bool m_finished;
+};
+
+#endif
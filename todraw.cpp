@@ -14,56 +14,61 @@
 
 #include <QDataStream>
 #include <QPainter>
+#include <QPaintDevice>
 #include <QSvgRenderer>
 
-static QImage toImage(const QString &element, int width, int height, QSvgRenderer *renderer)
+#include "gameboard.h"
+#include "instrumentation.h"
+
+// Bigger than this and the element is not worth keeping around as a pixmap
+static const int maxCachedPixels = 512 * 512;
+
+ToDraw::ToDraw(Gameboard *gameboard, int element)
+ : m_gameboard(gameboard), m_element(element), m_beingDragged(false)
 {
-  QImage img(width, height, QImage::Format_ARGB32_Premultiplied);
-  img.fill(Qt::transparent);
-  QPainter p2(&img);
-  // don't need quality here
-  p2.setRenderHints(QPainter::Antialiasing|QPainter::TextAntialiasing|QPainter::SmoothPixmapTransform, false);
-  renderer->render(&p2, element);
-  p2.end();
-  return img;
+  // the bounding rect depends on the position, see itemChange()
+  setFlag(QGraphicsItem::ItemSendsGeometryChanges);
 }
 
-
-ToDraw::ToDraw()
- : m_beingDragged(false)
+// Save an object to a file
+void ToDraw::save(QDataStream &stream) const
 {
+  stream << pos();
+  stream << elementId();
+  stream << zValue();
 }
 
-// Load an object from a file
-bool ToDraw::load(QDataStream &stream)
+Gameboard *ToDraw::gameboard() const
 {
-  // NOTE: read error checking?
-  QPointF pos;
-  QString element;
-  qreal zOrder;
+  return m_gameboard;
+}
 
-  stream >> pos;
-  stream >> element;
-  stream >> zOrder;
+int ToDraw::element() const
+{
+  return m_element;
+}
 
-  setPos(pos);
-  setElementId(element);
-  setZValue(zOrder);
+QString ToDraw::elementId() const
+{
+  return m_gameboard->elementId(m_element);
+}
 
-  return true;
+void ToDraw::setElement(int element)
+{
+  prepareGeometryChange();
+  m_element = element;
 }
 
-// Save an object to a file
-void ToDraw::save(QDataStream &stream) const
+// The gameboard was loaded again, the element may have another size now
+void ToDraw::gameboardChanged()
 {
-  stream << pos();
-  stream << elementId();
-  stream << zValue();
+  prepareGeometryChange();
+  update();
 }
 
 QRectF ToDraw::unclippedRect() const
 {
-  return QGraphicsSvgItem::boundingRect();
+  return QRectF(QPointF(0, 0), m_gameboard->geometry(m_element).size);
 }
 
 QRectF ToDraw::clippedRectAt(const QPointF &somePos) const
@@ -71,9 +76,7 @@ QRectF ToDraw::clippedRectAt(const QPointF &somePos) const
   if (m_beingDragged)
     return unclippedRect();
 
-  QRectF backgroundRect = renderer()->boundsOnElement(QStringLiteral( "background" ));
-  backgroundRect.translate(-somePos);
-  backgroundRect = transform().inverted().map(backgroundRect).boundingRect();
+  const QRectF backgroundRect = m_gameboard->backgroundRect().translated(-somePos);
 
   return unclippedRect().intersected(backgroundRect);
 }
@@ -95,18 +98,49 @@ QVariant ToDraw::itemChange(GraphicsItemChange change, const QVariant& value)
     if (boundingRect() != clippedRectAt(value.toPointF()))
       prepareGeometryChange();
   }
-  return QGraphicsSvgItem::itemChange(change, value);
+  return QGraphicsItem::itemChange(change, value);
+}
+
+// All the objects showing the same element at the same size share one pixmap
+void ToDraw::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*option*/, QWidget * /*widget*/)
+{
+  Instrumentation::Scope scope("ToDraw::paint");
+
+  const QRectF target = unclippedRect();
+  const QRectF clipped = boundingRect();
+  if (clipped.isEmpty()) return;
+
+  const qreal dpr = painter->device()->devicePixelRatioF();
+  const QSize deviceSize = (painter->transform().mapRect(target).size() * dpr).toSize();
+  // the item being dragged is always a sprite, whatever its size
+  const bool tooBig = !m_beingDragged && deviceSize.width() * deviceSize.height() > maxCachedPixels;
+  if (painter->transform().isRotating() || deviceSize.isEmpty() || tooBig)
+  {
+    painter->save();
+    painter->setClipRect(clipped, Qt::IntersectClip);
+    m_gameboard->renderer()->render(painter, elementId(), target);
+    painter->restore();
+    return;
+  }
+
+  const QPixmap pixmap = m_gameboard->elementPixmap(m_element, deviceSize);
+  const qreal xRatio = pixmap.width() / target.width();
+  const qreal yRatio = pixmap.height() / target.height();
+  const QRectF source((clipped.x() - target.x()) * xRatio, (clipped.y() - target.y()) * yRatio,
+                      clipped.width() * xRatio, clipped.height() * yRatio);
+  painter->drawPixmap(clipped, pixmap, source);
 }
 
 bool ToDraw::contains(const QPointF &point) const
 {
-	bool result = QGraphicsSvgItem::contains(point);
+	Instrumentation::Scope scope("ToDraw::contains");
+	bool result = QGraphicsItem::contains(point);
 	if (result)
 	{
-		QRectF bounds = transform().mapRect(unclippedRect());
-		const QImage &img = toImage(elementId(), qRound(bounds.width()), qRound(bounds.height()), renderer());
-		QPointF transformedPoint = transform().map(point);
-		result = qAlpha(img.pixel(transformedPoint.toPoint())) != 0;
+		QRectF bounds = unclippedRect();
+		const QImage &mask = m_gameboard->elementMask(m_element, QSize(qRound(bounds.width()), qRound(bounds.height())));
+		const QPoint pixel = point.toPoint();
+		result = mask.valid(pixel) && mask.constScanLine(pixel.y())[pixel.x()] != 0;
 	}
 	return result;
 }
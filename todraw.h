@@ -13,15 +13,23 @@
 #ifndef _TODRAW_H_
 #define _TODRAW_H_
 
-#include <QGraphicsSvgItem>
+#include <QGraphicsItem>
 
-class ToDraw : public QGraphicsSvgItem
+class Gameboard;
+
+// Only knows its element, everything about it lives in the gameboard
+class ToDraw : public QGraphicsItem
 {
   public:
-    ToDraw();
+    explicit ToDraw(Gameboard *gameboard, int element = -1);
     
     void save(QDataStream &stream) const;
-    bool load(QDataStream &stream);
+
+    Gameboard *gameboard() const;
+    int element() const;
+    QString elementId() const;
+    void setElement(int element);
+    void gameboardChanged();
 
     bool contains(const QPointF &point) const override;
 
@@ -31,6 +39,8 @@ class ToDraw : public QGraphicsSvgItem
     QRectF boundingRect() const override;
     QRectF unclippedRect() const;
 
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
     void setBeingDragged(bool dragged);
 
   protected:
@@ -39,6 +49,8 @@ class ToDraw : public QGraphicsSvgItem
   private:
     QRectF clippedRectAt(const QPointF &somePos) const;
 
+    Gameboard *m_gameboard;
+    int m_element;
     bool m_beingDragged;
 };
 
@@ -23,23 +23,35 @@
 #include <kconfiggroup.h>
 #include <kcombobox.h>
 #include <ksharedconfig.h>
-#include <kio/job.h>
 
 #include <QApplication>
+#include <QBuffer>
 #include <QClipboard>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QImageWriter>
 #include <QMimeDatabase>
 #include <QPrintDialog>
 #include <QPrinter>
-#include <QTemporaryFile>
+#include <QProgressDialog>
+#include <QSharedPointer>
+#include <QSignalBlocker>
+#include <QTabWidget>
 #include <QWidgetAction>
+#include <QtConcurrentRun>
 
 #include "filefactory.h"
+#include "filetransfer.h"
+#include "gameboardrepository.h"
+#include "instrumentation.h"
+#include "performancecounters.h"
+#include "picturemimedata.h"
 #include "playground.h"
 #include "soundfactory.h"
 #include "playgrounddelegate.h"
+#include "thumbnailcache.h"
+#include "timelapse.h"
 
 // TODO kdelibs4support REMOVE
 #include <KLocale>
@@ -52,12 +64,21 @@ TopLevel::TopLevel()
 {
   QString board, language;
 
-  playGround = new PlayGround(this, this);
-  playGround->setObjectName( QStringLiteral( "playGround" ) );
+  // The documents share the gameboards, thumbnails and sounds, each has its own scenes and undo
+  documents = new QTabWidget(this);
+  documents->setDocumentMode(true);
+  documents->setTabsClosable(true);
+  documents->setMovable(true);
+  documents->setTabBarAutoHide(true);
+  connect(documents, &QTabWidget::currentChanged, this, &TopLevel::currentTabChanged);
+  connect(documents, &QTabWidget::tabCloseRequested, this, &TopLevel::closeTab);
 
   soundFactory = new SoundFactory(this);
 
-  setCentralWidget(playGround);
+  thumbnails = new ThumbnailCache(this);
+  connect(thumbnails, &ThumbnailCache::thumbnailReady, this, &TopLevel::thumbnailReady);
+
+  setCentralWidget(documents);
 
   playgroundsGroup = new QActionGroup(this);
   playgroundsGroup->setExclusive(true);
@@ -66,13 +87,20 @@ TopLevel::TopLevel()
   languagesGroup->setExclusive(true);
 
   setupKAction();
+  addPlayGround();
+  PerformanceCounters::self()->startupPhase("setup actions");
 
-  playGround->registerPlayGrounds();
+  GameboardRepository::self()->registerThemes(this, this);
+  PerformanceCounters::self()->startupPhase("register gameboards");
   soundFactory->registerLanguages();
+  PerformanceCounters::self()->startupPhase("register languages");
 
   readOptions(board, language);
+  PerformanceCounters::self()->startupPhase("read options");
   changeGameboard(board);
+  PerformanceCounters::self()->startupPhase("load gameboard");
   changeLanguage(language);
+  PerformanceCounters::self()->startupPhase("load language");
 }
 
 // Destructor
@@ -87,20 +115,65 @@ static bool actionSorterByName(QAction *a, QAction *b)
 }
 
 // Register an available gameboard
-void TopLevel::registerGameboard(const QString &menuText, const QString &board, const QPixmap &pixmap)
+void TopLevel::registerGameboard(const QString &menuText, const QString &board, const QString &gameboardFile)
+{
+  // Registered already if the theme changed on disk
+  QAction *existing = actionCollection()->action(board);
+  if (existing)
+  {
+    existing->setText(menuText);
+    const int index = playgroundCombo->findData(board, BOARD_THEME);
+    playgroundCombo->setItemText(index, menuText);
+    playgroundCombo->setItemData(index, QVariant(gameboardFile), GAMEBOARD_FILE);
+    thumbnails->invalidate(gameboardFile);
+    for (int tab = 0; tab < documents->count(); ++tab)
+    {
+      if (static_cast<PlayGround *>(documents->widget(tab))->currentGameboard() == board)
+        documents->setTabText(tab, existing->iconText());
+    }
+  }
+  else
+  {
+    KToggleAction *t = new KToggleAction(menuText, this);
+    actionCollection()->addAction(board, t);
+    t->setData(board);
+    connect(t, SIGNAL(toggled(bool)), SLOT(changeGameboard()));
+    playgroundsGroup->addAction(t);
+
+    playgroundCombo->addItem(menuText);
+    playgroundCombo->setItemData(playgroundCombo->count()-1,QVariant(board),BOARD_THEME);
+    playgroundCombo->setItemData(playgroundCombo->count()-1,QVariant(gameboardFile),GAMEBOARD_FILE);
+  }
+  plugGameboardActions();
+}
+
+// A theme went away from disk
+void TopLevel::unregisterGameboard(const QString &board)
+{
+  QAction *action = actionCollection()->action(board);
+  if (!action) return;
+
+  playgroundsGroup->removeAction(action);
+  actionCollection()->removeAction(action);
+  plugGameboardActions();
+
+  // the board being shown stays, even when it is the one removed
+  const QSignalBlocker blocker(playgroundCombo);
+  playgroundCombo->removeItem(playgroundCombo->findData(board, BOARD_THEME));
+}
+
+void TopLevel::plugGameboardActions()
 {
-  KToggleAction *t = new KToggleAction(menuText, this);
-  actionCollection()->addAction(board, t);
-  t->setData(board);
-  connect(t, SIGNAL(toggled(bool)), SLOT(changeGameboard()));
-  playgroundsGroup->addAction(t);
   QList<QAction*> actionList = playgroundsGroup->actions();
   qSort(actionList.begin(), actionList.end(), actionSorterByName);
   unplugActionList( QStringLiteral( "playgroundList" ) );
   plugActionList( QStringLiteral( "playgroundList" ), actionList );
+}
 
-  playgroundCombo->addItem(menuText,QVariant(pixmap));
-  playgroundCombo->setItemData(playgroundCombo->count()-1,QVariant(board),BOARD_THEME);
+// A gameboard preview the delegate asked for is there
+void TopLevel::thumbnailReady(const QString &/*gameboardFile*/)
+{
+  playgroundCombo->view()->viewport()->update();
 }
 
 // Register an available language
@@ -120,11 +193,20 @@ void TopLevel::registerLanguage(const QString &code, const QString &soundFile, b
   plugActionList( QStringLiteral( "languagesList" ), actionList );
 }
 
+// The theme file of a gameboard, saved games only have its file name
+static QString themeFile(const QString &gameboard)
+{
+  QFileInfo fi(gameboard);
+  if (fi.isRelative())
+    return FileFactory::locate(QLatin1String( "pics/" ) + gameboard);
+  return gameboard;
+}
+
 // Switch to another gameboard
 void TopLevel::changeGameboardFromCombo(int index)
 {
   QString newBoard = playgroundCombo->itemData(index,BOARD_THEME).toString();
-  changeGameboard(newBoard);
+  switchGameboard(newBoard);
 }
 
 void TopLevel::changeGameboard()
@@ -134,31 +216,70 @@ void TopLevel::changeGameboard()
   if (action->isChecked())
   {
     QString newGameBoard = action->data().toString();
-    changeGameboard(newGameBoard);
+    switchGameboard(newGameBoard);
   }
 }
 
-void TopLevel::changeGameboard(const QString &newGameBoard)
+// What the user picks loads in the background, the menu and the combo
+// show the new gameboard right away
+void TopLevel::switchGameboard(const QString &newGameBoard)
 {
-  if (newGameBoard == playGround->currentGameboard()) return;
+  PlayGround *playGround = currentPlayGround();
+  const QString fileToLoad = themeFile(newGameBoard);
+  if (fileToLoad == (playGround->isSwitching() ? playGround->switchingTo() : playGround->currentGameboard())) return;
 
-  QString fileToLoad;
-  QFileInfo fi(newGameBoard);
-  if (fi.isRelative())
   {
-    fileToLoad = FileFactory::locate(QLatin1String( "pics/" ) + newGameBoard);
+    const QSignalBlocker blocker(playgroundCombo);
+    playgroundCombo->setCurrentIndex(playgroundCombo->findData(fileToLoad, BOARD_THEME));
   }
-  else
+  QAction *action = actionCollection()->action(fileToLoad);
+  if (action) action->setChecked(true);
+  playGround->switchPlayGround(fileToLoad);
+}
+
+void TopLevel::playGroundLoaded(const QString &gameboardFile, bool ok)
+{
+  PlayGround *playGround = qobject_cast<PlayGround *>(sender());
+  QAction *action = actionCollection()->action(gameboardFile);
+  if (ok && action)
   {
-    fileToLoad = newGameBoard;
+    documents->setTabText(documents->indexOf(playGround), action->iconText());
+    if (playGround == currentPlayGround())
+    {
+      // already there when the user picked it, not when a file brought it
+      action->setChecked(true);
+      const QSignalBlocker blocker(playgroundCombo);
+      playgroundCombo->setCurrentIndex(playgroundCombo->findData(gameboardFile, BOARD_THEME));
+      writeOptions();
+    }
+  }
+  else if (playGround == currentPlayGround())
+  {
+    // same as when it does not load right away
+    if (QFileInfo(gameboardFile).fileName() != QLatin1String(DEFAULT_THEME))
+      changeGameboard(QLatin1String(DEFAULT_THEME));
+    else
+      KMessageBox::error(this, i18n("Error while loading the playground."));
   }
+}
 
-  int index = playgroundCombo->findData(fileToLoad, BOARD_THEME);
-  playgroundCombo->setCurrentIndex(index);
+void TopLevel::changeGameboard(const QString &newGameBoard)
+{
+  PlayGround *playGround = currentPlayGround();
+  if (newGameBoard == playGround->currentGameboard() && !playGround->isSwitching()) return;
+
+  const QString fileToLoad = themeFile(newGameBoard);
+
+  {
+    // not another switch in the background
+    const QSignalBlocker blocker(playgroundCombo);
+    playgroundCombo->setCurrentIndex(playgroundCombo->findData(fileToLoad, BOARD_THEME));
+  }
   QAction *action = actionCollection()->action(fileToLoad);
   if (action && playGround->loadPlayGround(fileToLoad))
   {
     action->setChecked(true);
+    documents->setTabText(documents->indexOf(playGround), action->iconText());
 
     // Change gameboard in the remembered options
     writeOptions();
@@ -216,10 +337,77 @@ void TopLevel::changeLanguage(const QString &soundFile)
   }
 }
 
+PlayGround *TopLevel::currentPlayGround() const
+{
+  return static_cast<PlayGround *>(documents->currentWidget());
+}
+
+PlayGround *TopLevel::addPlayGround()
+{
+  PlayGround *playGround = new PlayGround(this, documents);
+  playGround->setObjectName( QStringLiteral( "playGround" ) );
+  playGround->lockAspectRatio(actionCollection()->action(QStringLiteral( "lock_aspect_ratio" ))->isChecked());
+  connect(playGround, &PlayGround::playGroundLoaded, this, &TopLevel::playGroundLoaded);
+  documents->addTab(playGround, QString());
+  actionCollection()->action(QStringLiteral( "game_close_tab" ))->setEnabled(documents->count() > 1);
+  return playGround;
+}
+
+// Another document, showing the same gameboard as the current one
+void TopLevel::newTab()
+{
+  const QString board = currentPlayGround()->currentGameboard();
+  documents->setCurrentWidget(addPlayGround());
+  changeGameboard(board.isEmpty() ? QLatin1String(DEFAULT_THEME) : board);
+}
+
+void TopLevel::closeTab(int index)
+{
+  // there always is a document
+  if (documents->count() < 2) return;
+
+  PlayGround *playGround = static_cast<PlayGround *>(documents->widget(index));
+  // nothing left to load the file into
+  if (FileTransfer *transfer = m_openJobs.take(playGround))
+    transfer->kill();
+  documents->removeTab(index);
+  delete playGround;
+  actionCollection()->action(QStringLiteral( "game_close_tab" ))->setEnabled(documents->count() > 1);
+}
+
+void TopLevel::closeCurrentTab()
+{
+  closeTab(documents->currentIndex());
+}
+
+// The actions and the gameboard selection follow the current document
+void TopLevel::currentTabChanged()
+{
+  if (undoRedoPlayGround)
+    undoRedoPlayGround->disconnectUndoRedoActions(undoAction, redoAction);
+
+  PlayGround *playGround = currentPlayGround();
+  undoRedoPlayGround = playGround;
+  if (!playGround) return;
+
+  playGround->connectUndoAction(undoAction);
+  playGround->connectRedoAction(redoAction);
+  PerformanceCounters::self()->setPlayGround(playGround);
+
+  const QString board = playGround->isSwitching() ? playGround->switchingTo() : playGround->currentGameboard();
+  QAction *action = actionCollection()->action(board);
+  if (action)
+  {
+    // already showing or loading it, switchGameboard() has nothing to do
+    action->setChecked(true);
+    playgroundCombo->setCurrentIndex(playgroundCombo->findData(board, BOARD_THEME));
+  }
+}
+
 // Play a sound
-void TopLevel::playSound(const QString &ref)
+void TopLevel::playSound(Gameboard *gameboard, int sound)
 {
-  soundFactory->playSound(ref);
+  soundFactory->playSound(gameboard, sound);
 }
 
 // Read options from preferences file
@@ -255,11 +443,11 @@ void TopLevel::writeOptions()
   KConfigGroup config(KSharedConfig::openConfig(), "General");
   config.writeEntry("Sound", actionCollection()->action(QStringLiteral( "speech_no_sound" ))->isChecked() ? "off": "on");
 
-  config.writeEntry("Gameboard", playGround->currentGameboard());
+  config.writeEntry("Gameboard", currentPlayGround()->currentGameboard());
 
   config.writeEntry("Language", soundFactory->currentSoundFile());
 
-  config.writeEntry("KeepAspectRatio", playGround->isAspectRatioLocked());
+  config.writeEntry("KeepAspectRatio", currentPlayGround()->isAspectRatioLocked());
 }
 
 // KAction initialization (aka menubar + toolbar init)
@@ -274,18 +462,33 @@ void TopLevel::setupKAction()
   KStandardGameAction::print(this, SLOT(filePrint()), actionCollection());
   KStandardGameAction::quit(qApp, SLOT(quit()), actionCollection());
 
+  action = actionCollection()->addAction( QStringLiteral( "game_new_tab" ));
+  action->setText(i18n("New &Tab"));
+  action->setIcon(QIcon::fromTheme( QStringLiteral( "tab-new" )));
+  actionCollection()->setDefaultShortcut(action, Qt::CTRL + Qt::Key_T);
+  connect(action, &QAction::triggered, this, &TopLevel::newTab);
+
+  action = actionCollection()->addAction( QStringLiteral( "game_close_tab" ));
+  action->setText(i18n("&Close Tab"));
+  action->setIcon(QIcon::fromTheme( QStringLiteral( "tab-close" )));
+  actionCollection()->setDefaultShortcuts(action, KStandardShortcut::close());
+  connect(action, &QAction::triggered, this, &TopLevel::closeCurrentTab);
+
   action = actionCollection()->addAction( QStringLiteral( "game_save_picture" ));
   action->setText(i18n("Save &as Picture..."));
   connect(action, &QAction::triggered, this, &TopLevel::filePicture);
 
+  action = actionCollection()->addAction( QStringLiteral( "game_save_timelapse" ));
+  action->setText(i18n("Save &Time-Lapse..."));
+  connect(action, &QAction::triggered, this, &TopLevel::fileTimeLapse);
+
   //Edit
   action = KStandardAction::copy(this, SLOT(editCopy()), actionCollection());
   actionCollection()->addAction(action->objectName(), action);
 
-  action = KStandardAction::undo(0, 0, actionCollection());
-  playGround->connectUndoAction(action);
-  action = KStandardAction::redo(0, 0, actionCollection());
-  playGround->connectRedoAction(action);
+  // connected to the current document, see currentTabChanged()
+  undoAction = KStandardAction::undo(0, 0, actionCollection());
+  redoAction = KStandardAction::redo(0, 0, actionCollection());
 
   //Speech
   KToggleAction *t = new KToggleAction(i18n("&No Sound"), this);
@@ -299,13 +502,21 @@ void TopLevel::setupKAction()
   actionCollection()->addAction( QStringLiteral( "lock_aspect_ratio" ), t);
   connect(t, &QAction::triggered, this, &TopLevel::lockAspectRatio);
 
+  // Not in any menu on purpose, only reachable through its shortcut
+  t = new KToggleAction(i18n("Performance Instrumentation"), this);
+  t->setChecked(Instrumentation::self()->isEnabled());
+  actionCollection()->addAction( QStringLiteral( "toggle_instrumentation" ), t);
+  actionCollection()->setDefaultShortcut(t, Qt::CTRL + Qt::ALT + Qt::SHIFT + Qt::Key_P);
+  addAction(t);
+  connect(t, &QAction::triggered, this, &TopLevel::toggleInstrumentation);
+
   playgroundCombo = new KComboBox(this);
   playgroundCombo->setMinimumWidth(200);
   playgroundCombo->view()->setMinimumHeight(100);
   playgroundCombo->view()->setMinimumWidth(200);
   playgroundCombo->view()->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
 
-  PlaygroundDelegate *playgroundDelegate = new PlaygroundDelegate(playgroundCombo->view());
+  PlaygroundDelegate *playgroundDelegate = new PlaygroundDelegate(thumbnails, GAMEBOARD_FILE, playgroundCombo->view());
   playgroundCombo->setItemDelegate(playgroundDelegate);
 
   connect(playgroundCombo, SIGNAL(currentIndexChanged(int)),this,SLOT(changeGameboardFromCombo(int)));
@@ -329,7 +540,7 @@ void TopLevel::saveNewToolbarConfig()
 // Reset gameboard
 void TopLevel::fileNew()
 {
-  playGround->reset();
+  currentPlayGround()->reset();
 }
 
 // Load gameboard
@@ -346,23 +557,38 @@ void TopLevel::open(const QUrl &url)
   if (url.isEmpty())
     return;
 
-  QString name;
-  if (url.isLocalFile()) {
-    // file protocol. We do not need the network
-    name = url.toLocalFile();
-  } else {
-    QTemporaryFile tmpFile;
-    tmpFile.setAutoRemove(false);
-    tmpFile.open();
-    name = tmpFile.fileName();
-    const QUrl dest = QUrl::fromLocalFile(name);
-    KIO::Job *job = KIO::file_copy(url, dest, -1, KIO::Overwrite | KIO::HideProgressInfo);
-    QEventLoop eventLoop;
-    connect(job, &KIO::Job::result, &eventLoop, &QEventLoop::quit);
-    eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
-  }
+  // The file goes to the document it was opened in, even if another one
+  // is shown by the time it is read. A newer request for the same
+  // document wins over a read still in flight.
+  PlayGround *current = currentPlayGround();
+  if (FileTransfer *previous = m_openJobs.take(current))
+    previous->kill();
+
+  FileTransfer *transfer = FileTransfer::get(url, this);
+  m_openJobs.insert(current, transfer);
+  const QPointer<PlayGround> playGround = current;
+  connect(transfer, &FileTransfer::finished, this, [this, transfer, playGround](bool ok)
+  {
+    // closed meanwhile, closeTab() dropped its entry
+    if (!playGround)
+      return;
+    m_openJobs.remove(playGround);
 
-  switch(playGround->loadFrom(name))
+    if (!ok)
+    {
+      KMessageBox::error(this, i18n("Could not load file."));
+      return;
+    }
+
+    QByteArray data = transfer->data();
+    QBuffer buffer(&data);
+    loadFrom(playGround, &buffer);
+  });
+}
+
+void TopLevel::loadFrom(PlayGround *playGround, QIODevice *device)
+{
+  switch(playGround->loadFrom(device))
   {
     case PlayGround::NoError:
      // good
@@ -376,10 +602,6 @@ void TopLevel::open(const QUrl &url)
       KMessageBox::error(this, i18n("Could not load file."));
     break;
   }
-
-  if (!url.isLocalFile()) {
-    QFile::remove(name);
-  }
 }
 
 // Save gameboard
@@ -390,33 +612,16 @@ void TopLevel::fileSave()
   if (url.isEmpty())
     return;
 
-  QTemporaryFile tempFile; // for network saving
-  QString name;
-  if( !url.isLocalFile() )
-  {
-    if (tempFile.open()) name = tempFile.fileName();
-    else
-    {
-      KMessageBox::error(this, i18n("Could not save file."));
-      return;
-    }
-  }
-  else
-  {
-    name = url.path();
-  }
-
-  if( !playGround->saveAs( name ) )
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  if( !currentPlayGround()->saveAs( &buffer ) )
   {
     KMessageBox::error(this, i18n("Could not save file."));
     return;
   }
 
-  if( !url.isLocalFile() )
-  {
-    if (!upload(name, url))
-      KMessageBox::error(this, i18n("Could not save file."));
-  }
+  upload(data, url);
 }
 
 // Save gameboard as picture
@@ -453,38 +658,80 @@ void TopLevel::filePicture()
   if( url.isEmpty() )
     return;
 
-  QTemporaryFile tempFile; // for network saving
-  QString name;
-  if( !url.isLocalFile() )
+  QByteArray format = QFileInfo(url.path()).suffix().toLatin1();
+  if (format.isEmpty())
+    format = "png";
+  const QImage picture = currentPlayGround()->getImage();
+
+  // Encoding big pictures takes a while, do it away from the GUI thread
+  QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
+  connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher, url]
   {
-    tempFile.open();
-    name = tempFile.fileName();
-  }
-  else
+    const QByteArray data = watcher->result();
+    if (data.isEmpty())
+    {
+      KMessageBox::error
+        (this, i18n("Could not save file."));
+    }
+    else
+    {
+      upload(data, url);
+    }
+
+    watcher->deleteLater();
+  });
+  watcher->setFuture(QtConcurrent::run([picture, format]
   {
-    name = url.path();
-  }
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!picture.save(&buffer, format.constData()))
+      data.clear();
+    return data;
+  }));
+}
 
-  QPixmap picture(playGround->getPicture());
+// Save how the tuberling was built, one picture per step of its history.
+// It is replayed on a copy, the document can go on being used meanwhile.
+void TopLevel::fileTimeLapse()
+{
+  TimeLapse *timeLapse = currentPlayGround()->timeLapse();
+  if (!timeLapse)
+  {
+    KMessageBox::sorry(this, i18n("There is nothing to replay yet."));
+    return;
+  }
 
-  if (!picture.save(name))
+  const QString dir = QFileDialog::getExistingDirectory(this, i18n("Save Time-Lapse"));
+  if (dir.isEmpty())
   {
-    KMessageBox::error
-      (this, i18n("Could not save file."));
+    delete timeLapse;
     return;
   }
 
-  if( !url.isLocalFile() )
+  timeLapse->setParent(this);
+  QProgressDialog *progress = new QProgressDialog(i18n("Saving the time-lapse..."), i18n("Cancel"), 0, timeLapse->frameCount(), this);
+  progress->setWindowTitle(i18n("Save Time-Lapse"));
+  progress->setAutoClose(false);
+  progress->setAutoReset(false);
+  connect(progress, &QProgressDialog::canceled, timeLapse, &TimeLapse::cancel);
+  connect(timeLapse, &TimeLapse::progress, progress, &QProgressDialog::setValue);
+  connect(timeLapse, &TimeLapse::finished, this, [this, timeLapse, progress](bool ok)
   {
-    if (!upload(name, url))
+    const bool canceled = progress->wasCanceled();
+    progress->deleteLater();
+    timeLapse->deleteLater();
+    if (!ok && !canceled)
       KMessageBox::error(this, i18n("Could not save file."));
-  }
+  });
 
+  timeLapse->save(dir, QFileInfo(currentPlayGround()->currentGameboard()).completeBaseName());
 }
 
 // Save gameboard as picture
 void TopLevel::filePrint()
 {
+  PlayGround *playGround = currentPlayGround();
   QPrinter printer;
   bool ok;
 
@@ -506,9 +753,9 @@ void TopLevel::filePrint()
 void TopLevel::editCopy()
 {
   QClipboard *clipboard = QApplication::clipboard();
-  QPixmap picture(playGround->getPicture());
 
-  clipboard->setPixmap(picture);
+  // Formats are only encoded once somebody pastes them
+  clipboard->setMimeData(new PictureMimeData(currentPlayGround()->getImage()));
 }
 
 // Toggle sound off
@@ -528,20 +775,31 @@ void TopLevel::toggleFullScreen()
   KToggleFullScreenAction::setFullScreen( this, actionCollection()->action(QStringLiteral( "fullscreen" ))->isChecked());
 }
 
+void TopLevel::toggleInstrumentation(bool enabled)
+{
+  Instrumentation::self()->setEnabled(enabled);
+  for (int tab = 0; tab < documents->count(); ++tab)
+    static_cast<PlayGround *>(documents->widget(tab))->setInstrumentationShown(enabled);
+}
+
 void TopLevel::lockAspectRatio(bool lock)
 {
   actionCollection()->action(QStringLiteral( "lock_aspect_ratio" ))->setChecked(lock);
-  playGround->lockAspectRatio(lock);
+  for (int tab = 0; tab < documents->count(); ++tab)
+    static_cast<PlayGround *>(documents->widget(tab))->lockAspectRatio(lock);
   writeOptions();
 }
 
-bool TopLevel::upload(const QString &src, const QUrl &target)
+void TopLevel::upload(const QByteArray &data, const QUrl &target)
 {
-  bool success = true;
-  const QUrl srcUrl = QUrl::fromLocalFile(src);
-  KIO::Job *job = KIO::file_copy(srcUrl, target, -1, KIO::Overwrite | KIO::HideProgressInfo);
-  QEventLoop eventLoop;
-  connect(job, &KIO::Job::result, this, [job, &eventLoop, &success] { success = !job->error(); eventLoop.quit(); } );
-  eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
-  return success;
+  // Saving again to the same place replaces the pending upload
+  if (m_uploadJob && m_uploadJob->url() == target)
+    m_uploadJob->kill();
+
+  m_uploadJob = FileTransfer::put(data, target, this);
+  connect(m_uploadJob, &FileTransfer::finished, this, [this](bool ok)
+  {
+    if (!ok)
+      KMessageBox::error(this, i18n("Could not save file."));
+  });
 }
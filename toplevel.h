@@ -14,11 +14,19 @@
 #include <kxmlguiwindow.h>
 #include <kcombobox.h>
 
+#include <QHash>
+#include <QPointer>
+#include <QUrl>
+
 #include "soundfactory.h"
 #include "playground.h"
 
 class QActionGroup;
+class QIODevice;
+class QTabWidget;
 class PlayGround;
+class FileTransfer;
+class ThumbnailCache;
 
 class TopLevel : public KXmlGuiWindow, public SoundFactoryCallbacks, public PlayGroundCallbacks
 {
@@ -30,19 +38,25 @@ public:
   ~TopLevel();
 
   void open(const QUrl &url);
-  void registerGameboard(const QString& menuText, const QString& boardFile, const QPixmap& pixmap) override;
+  void registerGameboard(const QString& menuText, const QString& boardFile, const QString& gameboardFile) override;
+  void unregisterGameboard(const QString& boardFile) override;
   void registerLanguage(const QString &code, const QString &soundFile, bool enabled) override;
   void changeLanguage(const QString &langCode);
-  void playSound(const QString &ref) override;
+  void playSound(Gameboard *gameboard, int sound) override;
 
   bool isSoundEnabled() const override;
 
+  // Waits for the gameboard to be loaded, switchGameboard() does not
   void changeGameboard(const QString &gameboard);
 
+  PlayGround *currentPlayGround() const;
+
 protected:
   void readOptions(QString &board, QString &language);
   void writeOptions();
   void setupKAction();
+  void plugGameboardActions();
+  PlayGround *addPlayGround();
 
 protected slots:
   void saveNewToolbarConfig() override;
@@ -53,17 +67,27 @@ private slots:
   void fileOpen();
   void fileSave();
   void filePicture();
+  void fileTimeLapse();
   void filePrint();
   void editCopy();
   void soundOff();
   void changeGameboardFromCombo(int index);
   void changeGameboard();
+  void switchGameboard(const QString &gameboard);
+  void playGroundLoaded(const QString &gameboardFile, bool ok);
   void changeLanguage();
   void toggleFullScreen();
   void lockAspectRatio(bool lock);
+  void toggleInstrumentation(bool enabled);
+  void thumbnailReady(const QString &gameboardFile);
+  void newTab();
+  void closeTab(int index);
+  void closeCurrentTab();
+  void currentTabChanged();
 
 private:
-  bool upload(const QString &src, const QUrl &target);
+  void loadFrom(PlayGround *playGround, QIODevice *device);
+  void upload(const QByteArray &data, const QUrl &target);
 
   int                           // Menu items identificators
       newID, openID, saveID, pictureID, printID, quitID,
@@ -73,15 +97,21 @@ private:
       ID_NEW, ID_OPEN, ID_SAVE, ID_PRINT,
       ID_UNDO, ID_REDO,
       ID_HELP };
-  enum { BOARD_THEME = Qt::UserRole + 1};
+  enum { BOARD_THEME = Qt::UserRole + 1, GAMEBOARD_FILE };
 
 
   QActionGroup *playgroundsGroup, *languagesGroup;
   KComboBox *playgroundCombo;
 
-  PlayGround *playGround;	// Play ground central widget
+  QTabWidget *documents;	// Play grounds, the central widget
+  QPointer<PlayGround> undoRedoPlayGround;	// the one the undo and redo actions act on
+  QAction *undoAction, *redoAction;
   SoundFactory *soundFactory;	// Speech organ
+  ThumbnailCache *thumbnails;	// Gameboard previews
   QMap<QString, QString> sounds; // language code, file
+
+  QHash<PlayGround *, QPointer<FileTransfer>> m_openJobs;	// read of the file being opened, by document
+  QPointer<FileTransfer> m_uploadJob;   // last save started
 };
 
 #endif
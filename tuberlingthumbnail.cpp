@@ -0,0 +1,201 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Thumbnails of saved tuberlings for file managers */
+
+#include "tuberlingthumbnail.h"
+
+#include <algorithm>
+
+#include <QDomDocument>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QSvgRenderer>
+#include <QVector>
+
+#include "savegame.h"
+
+// Themes kept loaded between thumbnails
+static const int maxCachedThemes = 8;
+
+extern "C"
+{
+  Q_DECL_EXPORT ThumbCreator *new_creator()
+  {
+    return new TuberlingThumbnail;
+  }
+}
+
+// Not the game's FileFactory, its data dirs are those of the application running it
+static QString locateTheme(const QString &relativePath)
+{
+  return QStandardPaths::locate(QStandardPaths::GenericDataLocation, QLatin1String( "ktuberling/pics/" ) + relativePath);
+}
+
+// What of a theme thumbnails need, rasterized at the scale asked for last
+class TuberlingThumbnail::Theme
+{
+  public:
+    bool load(const QString &themeFile);
+    QImage compose(const QVector<SaveGameReader::Item> &items, const QSize &maxSize);
+
+  private:
+    const QImage &element(const QString &elementId);
+
+    QSvgRenderer m_renderer;
+    QColor m_backgroundColor;
+    QRectF m_backgroundRect;
+    QHash<QString, qreal> m_scales;		// element -> scale of its objects
+    qreal m_scale = 0;				// of the rasters
+    QImage m_background;
+    QHash<QString, QImage> m_elements;
+};
+
+bool TuberlingThumbnail::Theme::load(const QString &themeFile)
+{
+  QFile layoutFile(themeFile);
+  if (!layoutFile.open(QIODevice::ReadOnly)) return false;
+  QDomDocument layoutDocument;
+  if (!layoutDocument.setContent(&layoutFile)) return false;
+
+  const QDomElement playGroundElement = layoutDocument.documentElement();
+  if (!m_renderer.load(locateTheme(playGroundElement.attribute(QStringLiteral( "gameboard" )))))
+    return false;
+
+  m_backgroundColor = QColor(playGroundElement.attribute(QStringLiteral( "bgcolor" ), QStringLiteral( "#fff" ) ) );
+  if (!m_backgroundColor.isValid())
+    m_backgroundColor = Qt::white;
+
+  // what the game saves as the picture
+  m_backgroundRect = m_renderer.boundsOnElement(QStringLiteral( "background" ));
+  if (m_backgroundRect.isEmpty())
+    m_backgroundRect = QRectF(QPointF(0, 0), m_renderer.defaultSize());
+
+  const QDomNodeList objectsList = playGroundElement.elementsByTagName(QStringLiteral( "object" ));
+  for (int decoration = 0; decoration < objectsList.count(); decoration++)
+  {
+    const QDomElement objectElement = objectsList.item(decoration).toElement();
+    m_scales.insert(objectElement.attribute(QStringLiteral( "name" )),
+                    objectElement.attribute(QStringLiteral( "scale" ), QStringLiteral( "1" )).toDouble());
+  }
+  return true;
+}
+
+const QImage &TuberlingThumbnail::Theme::element(const QString &elementId)
+{
+  QHash<QString, QImage>::const_iterator it = m_elements.constFind(elementId);
+  if (it != m_elements.constEnd())
+    return it.value();
+
+  // null for elements of another version of the theme, they are left out
+  QImage image;
+  const QSize size = (m_renderer.boundsOnElement(elementId).size() * m_scales.value(elementId, 1) * m_scale).toSize();
+  if (m_renderer.elementExists(elementId) && !size.isEmpty())
+  {
+    image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    m_renderer.render(&painter, elementId, QRectF(QPointF(0, 0), size));
+  }
+  return m_elements.insert(elementId, image).value();
+}
+
+QImage TuberlingThumbnail::Theme::compose(const QVector<SaveGameReader::Item> &items, const QSize &maxSize)
+{
+  const qreal scale = qMin(maxSize.width() / m_backgroundRect.width(), maxSize.height() / m_backgroundRect.height());
+  if (scale != m_scale)
+  {
+    m_scale = scale;
+    m_background = QImage();
+    m_elements.clear();
+  }
+
+  if (m_background.isNull())
+  {
+    const QSize size = (m_backgroundRect.size() * scale).toSize().expandedTo(QSize(1, 1));
+    m_background = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    m_background.fill(m_backgroundColor);
+    QPainter painter(&m_background);
+    painter.scale(scale, scale);
+    painter.translate(-m_backgroundRect.topLeft());
+    m_renderer.render(&painter, QRectF(QPointF(0, 0), m_renderer.defaultSize()));
+  }
+
+  // the objects are clipped to the background as in the game
+  QImage result = m_background;
+  QPainter painter(&result);
+  for (const SaveGameReader::Item &item : items)
+  {
+    const QImage &image = element(item.element);
+    if (!image.isNull())
+      painter.drawImage((item.pos - m_backgroundRect.topLeft()) * scale, image);
+  }
+  painter.end();
+  return result;
+}
+
+TuberlingThumbnail::TuberlingThumbnail()
+{
+  m_themes.setMaxCost(maxCachedThemes);
+}
+
+TuberlingThumbnail::~TuberlingThumbnail()
+{
+}
+
+TuberlingThumbnail::Theme *TuberlingThumbnail::theme(const QString &themeFileName)
+{
+  if (Theme *theme = m_themes.object(themeFileName))
+    return theme;
+
+  Theme *theme = new Theme();
+  if (!theme->load(locateTheme(themeFileName)))
+  {
+    delete theme;
+    return nullptr;
+  }
+  m_themes.insert(themeFileName, theme);
+  return theme;
+}
+
+bool TuberlingThumbnail::create(const QString &path, int width, int height, QImage &img)
+{
+  QFile file(path);
+  SaveGameReader reader;
+  if (reader.open(&file) != SaveGameReader::NoError)
+    return false;
+
+  // positions in the oldest saves depend on a window size nobody knows any more, they are taken as is
+  QVector<SaveGameReader::Item> items;
+  SaveGameReader::Item item;
+  while (!reader.atEnd())
+  {
+    if (!reader.readItem(&item))
+      return false;
+    items << item;
+  }
+  std::stable_sort(items.begin(), items.end(), [](const SaveGameReader::Item &a, const SaveGameReader::Item &b) {
+    return a.z < b.z;
+  });
+
+  Theme *theme = this->theme(reader.gameboard());
+  if (!theme)
+    return false;
+
+  img = theme->compose(items, QSize(width, height));
+  return true;
+}
+
+ThumbCreator::Flags TuberlingThumbnail::flags() const
+{
+  return None;
+}
@@ -0,0 +1,38 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by The KTuberling Developers                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+/* Thumbnails of saved tuberlings for file managers */
+
+#ifndef TUBERLINGTHUMBNAIL_H
+#define TUBERLINGTHUMBNAIL_H
+
+#include <kio/thumbcreator.h>
+
+#include <QCache>
+
+// No scene, no items: the saved objects are blitted straight onto the
+// background. The thumbnailer process makes many thumbnails in a row, so
+// the rasters of the themes stay around for the next files.
+class TuberlingThumbnail : public ThumbCreator
+{
+  public:
+    TuberlingThumbnail();
+    ~TuberlingThumbnail() override;
+
+    bool create(const QString &path, int width, int height, QImage &img) override;
+    Flags flags() const override;
+
+  private:
+    class Theme;
+    Theme *theme(const QString &themeFileName);
+
+    QCache<QString, Theme> m_themes;
+};
+
+#endif